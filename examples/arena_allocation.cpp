@@ -0,0 +1,122 @@
+#include <microstl.h>
+
+#include <iostream>
+#include <chrono>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+// Memory resource that counts all allocations before passing them on to another resource
+struct CountingResource : std::pmr::memory_resource
+{
+	std::pmr::memory_resource* upstream;
+	size_t allocations = 0;
+	size_t bytes = 0;
+
+	CountingResource(std::pmr::memory_resource* u) : upstream(u) {}
+
+	void* do_allocate(size_t size, size_t alignment) override
+	{
+		allocations++;
+		bytes += size;
+		return upstream->allocate(size, alignment);
+	}
+
+	void do_deallocate(void* p, size_t size, size_t alignment) override
+	{
+		upstream->deallocate(p, size, alignment);
+	}
+
+	bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+	{
+		return this == &other;
+	}
+};
+
+// Loads the mesh, deduplicates its vertices and drops everything again
+bool loadMesh(const std::filesystem::path& filePath, std::pmr::memory_resource* resource)
+{
+	microstl::pmr::MeshReaderHandler meshHandler(resource);
+	microstl::Result result = microstl::Reader::readStlFile(filePath, meshHandler);
+	if (result != microstl::Result::Success)
+	{
+		std::cerr << "Error: " << microstl::getResultString(result) << std::endl;
+		return false;
+	}
+	microstl::pmr::FVMesh fvMesh = microstl::deduplicateVertices(meshHandler.mesh, resource);
+	return !fvMesh.vertices.empty();
+}
+
+// Loads the mesh repeatedly with the default heap or a fresh monotonic arena for each iteration and prints the statistics
+bool runPhase(const char* label, const std::filesystem::path& filePath, size_t iterations, bool useArena)
+{
+	CountingResource counter(std::pmr::new_delete_resource());
+	auto start = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < iterations; i++)
+	{
+		if (useArena)
+		{
+			// Request scoped monotonic arena that is released with a single call
+			std::pmr::monotonic_buffer_resource arena(&counter);
+			if (!loadMesh(filePath, &arena))
+				return false;
+		}
+		else if (!loadMesh(filePath, &counter)) // Default heap allocations for each container
+			return false;
+	}
+	auto time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	std::cout << label << ": " << counter.allocations << " allocations, "
+		<< counter.bytes / 1024 << " kB, " << time << " ms" << std::endl;
+	return true;
+}
+
+// Runs a phase in a child process to measure its peak resident set size separately from the other phase.
+// Both children start from the same parent, so the inherited memory is equal for both measurements.
+bool runSeparatePhase(const char* label, const std::filesystem::path& filePath, size_t iterations, bool useArena)
+{
+#ifndef _WIN32
+	std::cout.flush();
+	pid_t pid = fork();
+	if (pid == 0)
+		_exit(runPhase(label, filePath, iterations, useArena) ? 0 : 1);
+
+	int status = 0;
+	struct rusage usage = {};
+	if (pid < 0 || wait4(pid, &status, 0, &usage) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+		return false;
+#ifdef __APPLE__
+	long peakRss = usage.ru_maxrss / 1024; // Reported in bytes on macOS
+#else
+	long peakRss = usage.ru_maxrss;
+#endif
+	std::cout << label << ": peak RSS " << peakRss << " kB" << std::endl;
+	return true;
+#else
+	return runPhase(label, filePath, iterations, useArena);
+#endif
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		// The recommended test file is sphere_binary.stl
+		std::cerr << "Missing argument for input file!" << std::endl;
+		return 1;
+	}
+
+	std::filesystem::path filePath(argv[1]);
+	const size_t iterations = 100;
+
+	std::cout << "Loading " << filePath.filename() << " " << iterations << " times" << std::endl;
+
+	if (!runSeparatePhase("Default heap", filePath, iterations, false))
+		return 1;
+	if (!runSeparatePhase("Monotonic arena", filePath, iterations, true))
+		return 1;
+
+	return 0;
+}
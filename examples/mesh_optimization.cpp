@@ -0,0 +1,47 @@
+#include <microstl.h>
+
+#include <iostream>
+
+void printStatistics(const char* label, const microstl::FVMesh& mesh)
+{
+	auto stats = microstl::analyzeVertexCache(mesh);
+	std::cout << label << ": ACMR " << stats.acmr << ", ATVR " << stats.atvr << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		// The recommended test file is sphere_binary.stl
+		std::cerr << "Missing argument for input file!" << std::endl;
+		return 1;
+	}
+
+	std::filesystem::path filePath(argv[1]);
+	microstl::FVMeshReaderHandler meshHandler;
+	microstl::Result result = microstl::Reader::readStlFile(filePath, meshHandler);
+	if (result != microstl::Result::Success)
+	{
+		std::cerr << "Error: " << microstl::getResultString(result) << std::endl;
+		return 1;
+	}
+
+	// The facets are still in the order of the STL file
+	microstl::FVMesh& mesh = meshHandler.mesh;
+	std::cout << "Loaded " << filePath.filename() << " with " << mesh.facets.size() << " facets and "
+		<< mesh.vertices.size() << " vertices" << std::endl;
+	printStatistics("Original order", mesh);
+
+	// Reorder the facets for the vertex cache and the vertices for the fetch locality
+	microstl::optimizeVertexCache(mesh);
+	microstl::optimizeVertexFetch(mesh);
+	printStatistics("Optimized order", mesh);
+
+	// Split the mesh into meshlets with up to 64 vertices and 124 facets each
+	microstl::Meshlets meshlets = microstl::buildMeshlets(mesh);
+	std::cout << "Meshlets: " << meshlets.meshlets.size() << " with on average "
+		<< static_cast<double>(meshlets.vertices.size()) / std::max<size_t>(1, meshlets.meshlets.size())
+		<< " vertices" << std::endl;
+
+	return 0;
+}
@@ -34,5 +34,16 @@ int main(int argc, char** argv)
 	std::cout << "Old Vertex Count: " << duplicatedVerticesMesh.facets.size() * 3 << std::endl;
 	std::cout << "New Vertex Count: " << deduplicatedVerticesMesh.vertices.size() << std::endl;
 
+	// The FVMeshReaderHandler deduplicates the vertices already while parsing,
+	// so the duplicated vertices of all facets never need to be held in memory.
+	microstl::FVMeshReaderHandler fvMeshHandler;
+	result = microstl::Reader::readStlFile(filePath, fvMeshHandler);
+	if (result != microstl::Result::Success)
+	{
+		std::cerr << "Error: " << microstl::getResultString(result) << std::endl;
+		return 1;
+	}
+	std::cout << "Direct Vertex Count: " << fvMeshHandler.mesh.vertices.size() << std::endl;
+
 	return 0;
 }
@@ -2,17 +2,42 @@
 // See https://github.com/cry-inc/microstl for details
 
 #include <cstdint>
+#include <cstdio>
 #include <cstring>
 #include <cmath>
+#include <cerrno>
+#include <clocale>
 #include <string>
+#include <string_view>
+#include <charconv>
+#include <iterator>
 #include <fstream>
 #include <sstream>
 #include <filesystem>
 #include <streambuf>
 #include <vector>
+#include <memory_resource>
 #include <array>
 #include <algorithm>
 #include <exception>
+#include <atomic>
+#include <thread>
+#include <future>
+#include <numeric>
+#include <limits>
+#include <memory>
+#include <functional>
+#include <tuple>
+#include <mutex>
+#include <deque>
+#include <random>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 namespace microstl
 {
@@ -27,11 +52,17 @@ namespace microstl
 		LineLimitError = 6, // ASCII line size exceeded internal safety limit of ASCII_LINE_LIMIT
 		FacetCountError = 7, // Binray file exceeds internal safety limit of BINARY_FACET_LIMIT
 		EndianError = 8, // The code currently only supports little endian architectures
-		__LAST__RESULT__VALUE = 9 // Only used for automated checks
+		CacheFormatError = 9, // Cache file is invalid, has an unsupported version or a checksum mismatch
+		Cancelled = 10, // Reading or writing was stopped by the handler or provider with onProgress()
+		__LAST__RESULT__VALUE = 11 // Only used for automated checks
 	};
 
+	class FacetReader;
+
 	class Reader
 	{
+		friend class FacetReader;
+
 	public:
 		// Interface that must be implemented to receive the data from the STL file
 		class Handler
@@ -71,10 +102,36 @@ namespace microstl
 			// Can be called for non-zero attribute values of facets in binary STL files after onFacet()
 			virtual void onFacetAttributes(const uint8_t attributes[2]) {}
 
+			// Called every PROGRESS_INTERVAL facets (or ASCII lines) with the number of bytes and facets processed so far.
+			// Return false to stop the parsing, which then ends with Result::Cancelled.
+			virtual bool onProgress(uint64_t bytes, uint64_t facets) { return true; }
+
 			// Called when the parsing process finishes after all other methods
 			virtual void onEnd(Result result) {}
 		};
 
+		// Handler that forwards all calls to another handler.
+		// Can be used as base class to intercept only some of the calls.
+		class ForwardingHandler : public Handler
+		{
+		public:
+			ForwardingHandler(Handler& targetHandler) : target(targetHandler) {}
+			void onBegin(bool asciiMode) override { target.onBegin(asciiMode); }
+			void onBinaryHeader(const uint8_t header[80]) override { target.onBinaryHeader(header); }
+			void onFacetCount(uint32_t triangles) override { target.onFacetCount(triangles); }
+			void onName(const std::string& name) override { target.onName(name); }
+			bool forceRecalculateNormals() override { return target.forceRecalculateNormals(); }
+			bool disableRecalculateNormals() override { return target.disableRecalculateNormals(); }
+			void onError(size_t lineNumber) override { target.onError(lineNumber); }
+			void onFacet(const float v1[3], const float v2[3], const float v3[3], const float n[3]) override { target.onFacet(v1, v2, v3, n); }
+			void onFacetAttributes(const uint8_t attributes[2]) override { target.onFacetAttributes(attributes); }
+			bool onProgress(uint64_t bytes, uint64_t facets) override { return target.onProgress(bytes, facets); }
+			void onEnd(Result result) override { target.onEnd(result); }
+
+		protected:
+			Handler& target;
+		};
+
 		// Read STL file directly from disk using an UTF8 or ASCII path
 		static Result readStlFile(const char* utf8FilePath, Handler& handler)
 		{
@@ -107,47 +164,307 @@ namespace microstl
 		// Read STL file from a memory buffer
 		static Result readStlBuffer(const char* buffer, size_t bufferSize, Handler& handler)
 		{
+			bool asciiMode = isAsciiFormat(buffer, std::min(bufferSize, DETECTION_SIZE), bufferSize);
 			imstream stream(buffer, bufferSize);
-			return readStlStream(stream, handler);
+			return readStlStream(stream, asciiMode, handler);
 		}
 
-		// Read STL file from a std::istream source
+		// Read STL file from a std::istream source, which does not need to be seekable.
+		// The start of the stream is sniffed for the format detection and replayed afterwards.
 		static Result readStlStream(std::istream& is, Handler& handler)
 		{
-			bool asciiMode = isAsciiFormat(is);
-			handler.onBegin(asciiMode);
-			Result result = asciiMode ? readAsciiStream(is, handler) : readBinaryStream(is, handler);
+			replaystream stream(is);
+			Result result = readStlStream(stream, stream.asciiMode, handler);
+			is.setstate(stream.rdstate());
+			return result;
+		}
+
+		// Result of a single file when reading multiple files at once
+		struct FileResult
+		{
+			std::filesystem::path path;
+			Result result = Result::Undefined;
+			size_t errorLineNumber = 0;
+			std::unique_ptr<Handler> handler;
+		};
+
+		// Factory that creates a new handler for each file, it will be called concurrently from multiple threads.
+		// Returning no handler is an error that is reported with an exception after all workers have finished.
+		using HandlerFactory = std::function<std::unique_ptr<Handler>(const std::filesystem::path& filePath)>;
+
+		// Read multiple STL files concurrently on a pool of worker threads, each file gets its own handler from the factory.
+		// The results are returned in the same order as the paths, a thread count of zero will use all hardware threads.
+		static std::vector<FileResult> readStlFiles(const std::vector<std::filesystem::path>& filePaths,
+			const HandlerFactory& handlerFactory, size_t threadCount = 0)
+		{
+			std::vector<FileResult> results(filePaths.size());
+			if (filePaths.empty())
+				return results;
+			if (threadCount == 0)
+				threadCount = std::max<size_t>(1, std::thread::hardware_concurrency());
+			threadCount = std::min(threadCount, filePaths.size());
+
+			// Start with the largest files so they will not end up as stragglers
+			std::vector<uintmax_t> sizes(filePaths.size());
+			for (size_t i = 0; i < filePaths.size(); i++)
+			{
+				std::error_code error;
+				sizes[i] = std::filesystem::file_size(filePaths[i], error);
+				if (error)
+					sizes[i] = 0;
+			}
+			std::vector<size_t> order(filePaths.size());
+			std::iota(order.begin(), order.end(), size_t(0));
+			std::stable_sort(order.begin(), order.end(), [&](size_t i1, size_t i2) { return sizes[i1] > sizes[i2]; });
+
+			// Each worker owns a queue and steals from the back of the other queues when its own queue runs empty
+			struct Queue { std::mutex mutex; std::deque<size_t> items; };
+			std::vector<Queue> queues(threadCount);
+			for (size_t i = 0; i < order.size(); i++)
+				queues[i % threadCount].items.push_back(order[i]);
+
+			struct ErrorLineHandler : ForwardingHandler
+			{
+				size_t errorLineNumber = 0;
+				ErrorLineHandler(Handler& h) : ForwardingHandler(h) {}
+				void onError(size_t lineNumber) override { errorLineNumber = lineNumber; target.onError(lineNumber); }
+			};
+
+			std::mutex exceptionMutex;
+			std::exception_ptr exception;
+			auto worker = [&](size_t id)
+			{
+				while (true)
+				{
+					bool found = false;
+					size_t index = 0;
+					for (size_t q = 0; !found && q < threadCount; q++)
+					{
+						auto& queue = queues[(id + q) % threadCount];
+						std::lock_guard<std::mutex> lock(queue.mutex);
+						if (!queue.items.empty())
+						{
+							index = q == 0 ? queue.items.front() : queue.items.back();
+							q == 0 ? queue.items.pop_front() : queue.items.pop_back();
+							found = true;
+						}
+					}
+
+					// No new work is created while reading, so empty queues mean that all files are done
+					if (!found)
+						return;
+
+					try
+					{
+						FileResult& fileResult = results[index];
+						fileResult.path = filePaths[index];
+						fileResult.handler = handlerFactory(fileResult.path);
+						if (!fileResult.handler)
+							throw std::runtime_error("Handler factory returned no handler");
+						ErrorLineHandler handler(*fileResult.handler);
+						fileResult.result = readStlFile(fileResult.path, handler);
+						fileResult.errorLineNumber = handler.errorLineNumber;
+					}
+					catch (...)
+					{
+						std::lock_guard<std::mutex> lock(exceptionMutex);
+						if (!exception)
+							exception = std::current_exception();
+					}
+				}
+			};
+
+			std::vector<std::thread> threads;
+			for (size_t t = 1; t < threadCount; t++)
+				threads.emplace_back(worker, t);
+			worker(0);
+			for (auto& thread : threads)
+				thread.join();
+			if (exception)
+				std::rethrow_exception(exception);
+
+			return results;
+		}
+
+		// Range of facets inside a binary STL file
+		struct FacetRange { uint32_t first = 0; uint32_t count = 0; };
+
+		// Read only the facets [first, first + count) of a binary STL file by seeking directly to the first one.
+		// The range is clipped to the facet count from the header, which is also passed to onFacetCount().
+		static Result readBinaryFacetRange(const std::filesystem::path& filePath, uint32_t first, uint32_t count, Handler& handler)
+		{
+			std::ifstream ifs(filePath, std::ios::binary);
+			if (!ifs)
+			{
+				auto result = Result::FileError;
+				handler.onBegin(false);
+				handler.onEnd(result);
+				return result;
+			}
+
+			return readBinaryFacetRange(ifs, first, count, handler);
+		}
+
+		// Same as above for a seekable std::istream source with binary STL data
+		static Result readBinaryFacetRange(std::istream& is, uint32_t first, uint32_t count, Handler& handler)
+		{
+			handler.onBegin(false);
+			Result result = readBinaryStream(is, handler, first, count);
 			handler.onEnd(result);
 			return result;
 		}
 
+		// Read the facet count from the header of a binary STL file and check if the file is large enough for them
+		static Result readBinaryFacetCount(const std::filesystem::path& filePath, uint32_t& facetCount)
+		{
+			facetCount = 0;
+			std::ifstream ifs(filePath, std::ios::binary);
+			if (!ifs)
+				return Result::FileError;
+
+			char buffer[84];
+			ifs.read(buffer, sizeof(buffer));
+			if (!ifs)
+				return Result::MissingDataError;
+			Result result = parseBinaryFacetCount(buffer + 80, facetCount);
+			if (result != Result::Undefined)
+				return result;
+
+			std::error_code error;
+			auto fileSize = std::filesystem::file_size(filePath, error);
+			if (error)
+				return Result::FileError;
+			if (fileSize < 84 + 50 * static_cast<uintmax_t>(facetCount))
+				return Result::MissingDataError;
+
+			return Result::Success;
+		}
+
+		// Split a number of facets into balanced ranges, for example to distribute them to multiple workers
+		static std::vector<FacetRange> planBinaryShards(uint32_t facetCount, size_t shardCount)
+		{
+			std::vector<FacetRange> shards;
+			shardCount = std::min<size_t>(shardCount, facetCount);
+			for (size_t i = 0; i < shardCount; i++)
+			{
+				uint64_t begin = static_cast<uint64_t>(facetCount) * i / shardCount;
+				uint64_t end = static_cast<uint64_t>(facetCount) * (i + 1) / shardCount;
+				shards.push_back(FacetRange{ static_cast<uint32_t>(begin), static_cast<uint32_t>(end - begin) });
+			}
+			return shards;
+		}
+
+		// Split the facets of a binary STL file into balanced ranges using the facet count from its header
+		static Result planBinaryShards(const std::filesystem::path& filePath, size_t shardCount, std::vector<FacetRange>& shards)
+		{
+			uint32_t facetCount = 0;
+			Result result = readBinaryFacetCount(filePath, facetCount);
+			shards = result == Result::Success ? planBinaryShards(facetCount, shardCount) : std::vector<FacetRange>();
+			return result;
+		}
+
 		// Some internal safety limits
 		static inline const size_t ASCII_LINE_LIMIT = 256u;
 		static inline const uint32_t BINARY_FACET_LIMIT = 500000000u;
 		static inline const float NORMAL_LENGTH_DEVIATION_LIMIT = 0.001f;
 
+		// Number of facets (or lines of ASCII files) between two progress reports
+		static inline const size_t PROGRESS_INTERVAL = 4096u;
+
+		// Marks an unknown total size of STL data
+		static inline const uint64_t UNKNOWN_SIZE = std::numeric_limits<uint64_t>::max();
+
+		// Calculates the normal from the counter-clockwise vertex order, degenerated facets get a zero normal
+		static void calculateNormals(const float v1[3], const float v2[3], const float v3[3], float n[3])
+		{
+			float u[3] = { v2[0] - v1[0], v2[1] - v1[1], v2[2] - v1[2] };
+			float v[3] = { v3[0] - v1[0], v3[1] - v1[1], v3[2] - v1[2] };
+			n[0] = u[1] * v[2] - u[2] * v[1];
+			n[1] = u[2] * v[0] - u[0] * v[2];
+			n[2] = u[0] * v[1] - u[1] * v[0];
+			float length = sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+			if (!(length > 0.0f))
+			{
+				// Degenerated facets without area get a zero normal instead of NaN values
+				n[0] = n[1] = n[2] = 0.0f;
+				return;
+			}
+			n[0] /= length;
+			n[1] /= length;
+			n[2] /= length;
+		}
+
+		// Returns true for zero normals and normals with an invalid length, compares the squared length to avoid the square root
+		static bool needsNormalFix(const float n[3])
+		{
+			const float minimum = (1.0f - NORMAL_LENGTH_DEVIATION_LIMIT) * (1.0f - NORMAL_LENGTH_DEVIATION_LIMIT);
+			const float maximum = (1.0f + NORMAL_LENGTH_DEVIATION_LIMIT) * (1.0f + NORMAL_LENGTH_DEVIATION_LIMIT);
+			float squaredLength = n[0] * n[0] + n[1] * n[1] + n[2] * n[2];
+			return squaredLength < minimum || squaredLength > maximum;
+		}
+
+		// Recalculates the normal if needsNormalFix() is true
+		static void checkAndFixNormals(const float v1[3], const float v2[3], const float v3[3], float n[3])
+		{
+			if (needsNormalFix(n))
+				calculateNormals(v1, v2, v3, n);
+		}
+
 	private:
-		static bool isAsciiFormat(std::istream& is)
+		// Number of bytes at the start of the data used for the format detection
+		static inline const size_t DETECTION_SIZE = 256u;
+
+		static Result readStlStream(std::istream& is, bool asciiMode, Handler& handler)
 		{
+			handler.onBegin(asciiMode);
+			Result result = asciiMode ? readAsciiStream(is, handler) : readBinaryStream(is, handler);
+			handler.onEnd(result);
+			return result;
+		}
+
+		static bool isAsciiFormat(const char* data, size_t size, uint64_t totalSize = UNKNOWN_SIZE)
+		{
+			// Binary files can be identified reliably when the total size is known
+			if (totalSize != UNKNOWN_SIZE && size >= 84)
+			{
+				uint32_t facetCount = 0;
+				memcpy(&facetCount, data + 80, 4);
+				if (totalSize == 84 + 50 * static_cast<uint64_t>(facetCount))
+					return false;
+			}
+
 			// Some CAD applications create binary files that have the string "solid" inside the header.
 			// This means we cannot just check the first word, but also need some additional heuristic checks.
 			// The checks below are inspired by https://github.com/sreiter/stl_reader/
 
-			std::array<char, 256> buffer{};
-			is.read(buffer.data(), buffer.size());
-			std::string str(buffer.data(), is.gcount());
-			is.clear();
-			is.seekg(0, std::ios_base::beg);
-
-			std::transform(str.begin(), str.end(), str.begin(), [](auto c){ return std::tolower(c); });
-			bool has_solid = str.find("solid") != std::string::npos;
-			bool has_newline = str.find('\n') != std::string::npos;
-			bool has_facet = str.find("facet") != std::string::npos;
-			bool has_normal = str.find("normal") != std::string::npos;
+			bool has_solid = containsWord(data, size, "solid");
+			bool has_newline = size > 0 && memchr(data, '\n', size) != nullptr;
+			bool has_facet = containsWord(data, size, "facet");
+			bool has_normal = containsWord(data, size, "normal");
 
 			return has_solid && has_newline && has_facet && has_normal;
 		}
 
+		// Case insensitive search for a lower case word
+		static bool containsWord(const char* data, size_t size, const char* word)
+		{
+			size_t wordLength = strlen(word);
+			for (size_t i = 0; i + wordLength <= size; i++)
+			{
+				size_t j = 0;
+				while (j < wordLength && toLower(data[i + j]) == word[j])
+					j++;
+				if (j == wordLength)
+					return true;
+			}
+			return false;
+		}
+
+		static inline char toLower(char c)
+		{
+			return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+		}
+
 		static bool readNextLine(std::istream& is, std::string& output)
 		{
 			output.resize(0);
@@ -157,7 +474,8 @@ namespace microstl
 			while (!is.eof())
 			{
 				char byte;
-				is.read(&byte, 1);
+				if (!is.read(&byte, 1))
+					break;
 				if (byte == '\n')
 					return true;
 				else if (output.size() > ASCII_LINE_LIMIT)
@@ -174,38 +492,17 @@ namespace microstl
 			return c == '\t' || c == ' ' || c == '\r' || c == '\n';
 		}
 
-		static std::string stringTrim(const std::string& input)
+		static std::string_view stringTrim(std::string_view input)
 		{
-			std::string output;
-
-			size_t index = 0, inputSize = input.size();
-			while (index < inputSize && isWhiteSpace(input[index]))
-				index++;
-
-			if (index == inputSize)
-				return output;
-
-			while (index < inputSize)
-			{
-				output.push_back(input[index]);
-				index++;
-			}
-
-			if (output.size() == 0)
-				return output;
-
-			index = output.size() - 1;
-			while (isWhiteSpace(output[index]))
-				if (index == 0)
-					break;
-				else
-					index--;
-
-			output.resize(index + 1);
-			return output;
+			size_t begin = 0, end = input.size();
+			while (begin < end && isWhiteSpace(input[begin]))
+				begin++;
+			while (end > begin && isWhiteSpace(input[end - 1]))
+				end--;
+			return input.substr(begin, end - begin);
 		}
 
-		static inline bool stringStartsWith(const std::string& str, const char* prefix)
+		static inline bool stringStartsWith(std::string_view str, const char* prefix)
 		{
 			size_t prefixLength = strlen(prefix);
 			if (prefixLength > str.size())
@@ -213,46 +510,85 @@ namespace microstl
 			return memcmp(prefix, str.data(), prefixLength) == 0;
 		}
 
-		static bool stringParseThreeValues(const std::string& str, float& v1, float& v2, float& v3)
+		static bool stringParseThreeValues(std::string_view str, float& v1, float& v2, float& v3)
 		{
-			std::stringstream ss(str);
-			ss >> v1;
-			if (!ss)
-				return false;
+			const char* ptr = str.data();
+			const char* end = str.data() + str.size();
+			return stringParseValue(ptr, end, v1) && stringParseValue(ptr, end, v2) && stringParseValue(ptr, end, v3);
+		}
 
-			ss >> v2;
-			if (!ss)
-				return false;
+		// Parses a single decimal value after optional white spaces without any allocations
+		static bool stringParseValue(const char*& ptr, const char* end, float& value)
+		{
+			while (ptr < end && isWhiteSpace(*ptr))
+				ptr++;
+			bool negative = false;
+			if (ptr < end && (*ptr == '+' || *ptr == '-'))
+				negative = *ptr++ == '-';
 
-			ss >> v3;
-			if (!ss)
+			// Only plain numbers like 1.5 or -2e3, no special values like inf or nan
+			if (ptr == end || !((*ptr >= '0' && *ptr <= '9') || *ptr == '.'))
 				return false;
+#ifdef __cpp_lib_to_chars
+			auto result = std::from_chars(ptr, end, value);
+			if (result.ec != std::errc())
+				return false;
+			ptr = result.ptr;
+#else
+			// Without floating point std::from_chars the number is copied to the stack and parsed with strtof.
+			// Numbers with more characters than the buffer are rejected.
+			const char* numberEnd = stringScanNumber(ptr, end);
+			char buffer[128];
+			size_t length = numberEnd - ptr;
+			if (length >= sizeof(buffer))
+				return false;
+			memcpy(buffer, ptr, length);
+			buffer[length] = '\0';
 
+			// strtof expects the decimal point of the current C locale
+			char* point = static_cast<char*>(memchr(buffer, '.', length));
+			if (point != nullptr)
+				*point = *localeconv()->decimal_point;
+			char* parsedEnd = nullptr;
+			errno = 0;
+			value = strtof(buffer, &parsedEnd);
+			if (parsedEnd != buffer + length || (errno == ERANGE && std::isinf(value)))
+				return false;
+			ptr = numberEnd;
+#endif
+			if (negative)
+				value = -value;
 			return true;
 		}
 
-		static void calculateNormals(const float v1[3], const float v2[3], const float v3[3], float n[3])
-		{
-			float u[3] = { v2[0] - v1[0], v2[1] - v1[1], v2[2] - v1[2] };
-			float v[3] = { v3[0] - v1[0], v3[1] - v1[1], v3[2] - v1[2] };
-			n[0] = u[1] * v[2] - u[2] * v[1];
-			n[1] = u[2] * v[0] - u[0] * v[2];
-			n[2] = u[0] * v[1] - u[1] * v[0];
-			float length = sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
-			n[0] /= length;
-			n[1] /= length;
-			n[2] /= length;
-		}
-
-		static void checkAndFixNormals(const float v1[3], const float v2[3], const float v3[3], float n[3])
+#ifndef __cpp_lib_to_chars
+		// Returns the end of a decimal number with an optional exponent, the same characters std::from_chars would consume
+		static const char* stringScanNumber(const char* ptr, const char* end)
 		{
-			if (n[0] == 0 && n[1] == 0 && n[2] == 0)
-				return calculateNormals(v1, v2, v3, n);
-
-			float length = sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
-			if (fabs(length - 1.0f) > NORMAL_LENGTH_DEVIATION_LIMIT)
-				return calculateNormals(v1, v2, v3, n);
+			auto isDigit = [](char c) { return c >= '0' && c <= '9'; };
+			while (ptr < end && isDigit(*ptr))
+				ptr++;
+			if (ptr < end && *ptr == '.')
+			{
+				ptr++;
+				while (ptr < end && isDigit(*ptr))
+					ptr++;
+			}
+			if (ptr < end && (*ptr == 'e' || *ptr == 'E'))
+			{
+				const char* exponent = ptr + 1;
+				if (exponent < end && (*exponent == '+' || *exponent == '-'))
+					exponent++;
+				if (exponent < end && isDigit(*exponent))
+				{
+					while (exponent < end && isDigit(*exponent))
+						exponent++;
+					ptr = exponent;
+				}
+			}
+			return ptr;
 		}
+#endif
 
 		static bool isLittleEndian()
 		{
@@ -261,30 +597,44 @@ namespace microstl
 			return *ptr == 1;
 		}
 
-		static Result readAsciiStream(std::istream& is, Handler& handler)
+		// State machine of the ASCII parser that is fed line by line
+		struct AsciiState
 		{
-			// State machine variables
 			bool activeSolid = false;
 			bool activeFacet = false;
 			bool activeLoop = false;
 			size_t lineNumber = 0, solidCount = 0, facetCount = 0, loopCount = 0, vertexCount = 0;
 			float n[3] = { 0, };
 			float v[9] = { 0, };
+			bool forceNewNormals = false;
+			bool disableNewNormals = false;
+		};
 
-			bool forceNewNormals = handler.forceRecalculateNormals();
-			bool disableNewNormals = handler.disableRecalculateNormals();
+		static Result readAsciiStream(std::istream& is, Handler& handler)
+		{
+			AsciiState state;
+			state.forceNewNormals = handler.forceRecalculateNormals();
+			state.disableNewNormals = handler.disableRecalculateNormals();
 
 			// Line reader with loop to work the state machine
+			std::string line;
+			uint64_t bytes = 0;
+			size_t nextProgress = PROGRESS_INTERVAL;
 			while (true)
 			{
-				lineNumber++;
-				std::string line;
+				if (state.lineNumber == nextProgress)
+				{
+					nextProgress += PROGRESS_INTERVAL;
+					if (!handler.onProgress(bytes, state.facetCount))
+						return Result::Cancelled;
+				}
+				state.lineNumber++;
 				if (!readNextLine(is, line))
 				{
 					if (is)
 					{
 						// input stream still good -> hit the line limit
-						handler.onError(lineNumber);
+						handler.onError(state.lineNumber);
 						return Result::LineLimitError;
 					}
 					else
@@ -293,106 +643,125 @@ namespace microstl
 						break;
 					}
 				}
-				line = stringTrim(line);
-				if (stringStartsWith(line, "solid"))
+				bytes += line.size() + 1;
+				Result result = parseAsciiLine(state, line, handler);
+				if (result != Result::Undefined)
+					return result;
+			}
+
+			return finishAscii(state);
+		}
+
+		// Processes the next line, returns Result::Undefined as long as no error occured
+		static Result parseAsciiLine(AsciiState& state, std::string_view line, Handler& handler)
+		{
+			line = stringTrim(line);
+			if (stringStartsWith(line, "solid"))
+			{
+				if (state.activeSolid || state.solidCount != 0)
 				{
-					if (activeSolid || solidCount != 0)
-					{
-						handler.onError(lineNumber);
-						return Result::UnexpectedError;
-					}
-					activeSolid = true;
-					if (line.length() > 5)
-					{
-						std::string name = stringTrim(line.substr(5));
-						handler.onName(name);
-					}
+					handler.onError(state.lineNumber);
+					return Result::UnexpectedError;
 				}
-				if (stringStartsWith(line, "endsolid"))
+				state.activeSolid = true;
+				if (line.length() > 5)
 				{
-					if (!activeSolid || activeFacet || activeLoop)
-					{
-						handler.onError(lineNumber);
-						return Result::UnexpectedError;
-					}
-					activeSolid = false;
-					solidCount++;
+					std::string name(stringTrim(line.substr(5)));
+					handler.onName(name);
 				}
-				if (stringStartsWith(line, "facet normal"))
+			}
+			if (stringStartsWith(line, "endsolid"))
+			{
+				if (!state.activeSolid || state.activeFacet || state.activeLoop)
 				{
-					if (!activeSolid || activeLoop || activeFacet)
-					{
-						handler.onError(lineNumber);
-						return Result::UnexpectedError;
-					}
-					activeFacet = true;
-					std::string tmp = stringTrim(line.substr(12));
-					if (!stringParseThreeValues(tmp, n[0], n[1], n[2]))
-					{
-						handler.onError(lineNumber);
-						return Result::ParserError;
-					}
+					handler.onError(state.lineNumber);
+					return Result::UnexpectedError;
+				}
+				state.activeSolid = false;
+				state.solidCount++;
+			}
+			if (stringStartsWith(line, "facet normal"))
+			{
+				if (!state.activeSolid || state.activeLoop || state.activeFacet)
+				{
+					handler.onError(state.lineNumber);
+					return Result::UnexpectedError;
 				}
-				if (stringStartsWith(line, "endfacet"))
+				state.activeFacet = true;
+				std::string_view tmp = stringTrim(line.substr(12));
+				if (!stringParseThreeValues(tmp, state.n[0], state.n[1], state.n[2]))
 				{
-					if (!activeSolid || activeLoop || !activeFacet || loopCount != 1)
-					{
-						handler.onError(lineNumber);
-						return Result::UnexpectedError;
-					}
-					activeFacet = false;
-					facetCount++;
-					loopCount = 0;
-					if (forceNewNormals && !disableNewNormals)
-						calculateNormals(v + 0, v + 3, v + 6, n);
-					else if (!disableNewNormals)
-						checkAndFixNormals(v + 0, v + 3, v + 6, n);
-					handler.onFacet(v + 0, v + 3, v + 6, n);
+					handler.onError(state.lineNumber);
+					return Result::ParserError;
 				}
-				if (stringStartsWith(line, "outer loop"))
+			}
+			if (stringStartsWith(line, "endfacet"))
+			{
+				if (!state.activeSolid || state.activeLoop || !state.activeFacet || state.loopCount != 1)
 				{
-					if (!activeSolid || !activeFacet || activeLoop)
-					{
-						handler.onError(lineNumber);
-						return Result::UnexpectedError;
-					}
-					activeLoop = true;
+					handler.onError(state.lineNumber);
+					return Result::UnexpectedError;
 				}
-				if (stringStartsWith(line, "endloop"))
+				state.activeFacet = false;
+				state.facetCount++;
+				state.loopCount = 0;
+				float* v = state.v;
+				if (state.forceNewNormals && !state.disableNewNormals)
+					calculateNormals(v + 0, v + 3, v + 6, state.n);
+				else if (!state.disableNewNormals)
+					checkAndFixNormals(v + 0, v + 3, v + 6, state.n);
+				handler.onFacet(v + 0, v + 3, v + 6, state.n);
+			}
+			if (stringStartsWith(line, "outer loop"))
+			{
+				if (!state.activeSolid || !state.activeFacet || state.activeLoop)
 				{
-					if (!activeSolid || !activeFacet || !activeLoop || vertexCount != 3)
-					{
-						handler.onError(lineNumber);
-						return Result::UnexpectedError;
-					}
-					activeLoop = false;
-					loopCount++;
-					vertexCount = 0;
+					handler.onError(state.lineNumber);
+					return Result::UnexpectedError;
 				}
-				if (stringStartsWith(line, "vertex"))
+				state.activeLoop = true;
+			}
+			if (stringStartsWith(line, "endloop"))
+			{
+				if (!state.activeSolid || !state.activeFacet || !state.activeLoop || state.vertexCount != 3)
 				{
-					if (!activeSolid || !activeFacet || !activeLoop || vertexCount >= 3)
-					{
-						handler.onError(lineNumber);
-						return Result::UnexpectedError;
-					}
-					std::string tmp = stringTrim(line.substr(6));
-					if (!stringParseThreeValues(tmp, v[vertexCount * 3 + 0], v[vertexCount * 3 + 1], v[vertexCount * 3 + 2]))
-					{
-						handler.onError(lineNumber);
-						return Result::ParserError;
-					}
-					vertexCount++;
+					handler.onError(state.lineNumber);
+					return Result::UnexpectedError;
+				}
+				state.activeLoop = false;
+				state.loopCount++;
+				state.vertexCount = 0;
+			}
+			if (stringStartsWith(line, "vertex"))
+			{
+				if (!state.activeSolid || !state.activeFacet || !state.activeLoop || state.vertexCount >= 3)
+				{
+					handler.onError(state.lineNumber);
+					return Result::UnexpectedError;
 				}
+				std::string_view tmp = stringTrim(line.substr(6));
+				float* v = state.v + state.vertexCount * 3;
+				if (!stringParseThreeValues(tmp, v[0], v[1], v[2]))
+				{
+					handler.onError(state.lineNumber);
+					return Result::ParserError;
+				}
+				state.vertexCount++;
 			}
 
-			if (activeSolid || activeFacet || activeLoop || solidCount == 0)
+			return Result::Undefined;
+		}
+
+		static Result finishAscii(const AsciiState& state)
+		{
+			if (state.activeSolid || state.activeFacet || state.activeLoop || state.solidCount == 0)
 				return Result::MissingDataError;
 
 			return Result::Success;
 		}
 
-		static Result readBinaryStream(std::istream& is, Handler& handler)
+		static Result readBinaryStream(std::istream& is, Handler& handler,
+			uint32_t firstFacet = 0, uint32_t maxFacets = std::numeric_limits<uint32_t>::max())
 		{
 			if (!isLittleEndian())
 				return Result::EndianError;
@@ -406,34 +775,65 @@ namespace microstl
 			is.read(buffer, 4);
 			if (!is)
 				return Result::MissingDataError;
-			uint32_t facetCount = *reinterpret_cast<uint32_t*>(buffer);
-			if (facetCount == 0)
-				return Result::MissingDataError;
-			if (facetCount > BINARY_FACET_LIMIT)
-				return Result::FacetCountError;
+			uint32_t facetCount = 0;
+			Result result = parseBinaryFacetCount(buffer, facetCount);
+			if (result != Result::Undefined)
+				return result;
+
+			// Only seek when reading a range, since not all streams support seeking
+			firstFacet = std::min(firstFacet, facetCount);
+			facetCount = std::min(maxFacets, facetCount - firstFacet);
 			handler.onFacetCount(facetCount);
+			if (firstFacet > 0)
+			{
+				is.seekg(84 + 50 * static_cast<std::streamoff>(firstFacet), std::ios_base::beg);
+				if (!is)
+					return Result::MissingDataError;
+			}
 
 			bool forceNewNormals = handler.forceRecalculateNormals();
 			bool disableNewNormals = handler.disableRecalculateNormals();
+			size_t nextProgress = PROGRESS_INTERVAL;
 			for (size_t t = 0; t < facetCount; t++)
 			{
+				if (t == nextProgress)
+				{
+					nextProgress += PROGRESS_INTERVAL;
+					if (!handler.onProgress(84 + 50 * static_cast<uint64_t>(t), t))
+						return Result::Cancelled;
+				}
 				is.read(buffer, 50);
 				if (!is)
 					return Result::MissingDataError;
-				float values[12];
-				memcpy(values, buffer, 4 * 12);
-				if (forceNewNormals && !disableNewNormals)
-					calculateNormals(values + 3, values + 6, values + 9, values);
-				else if (!disableNewNormals)
-					checkAndFixNormals(values + 3, values + 6, values + 9, values);
-				handler.onFacet(values + 3, values + 6, values + 9, values);
-				if (buffer[48] != 0 || buffer[49] != 0)
-					handler.onFacetAttributes(reinterpret_cast<const uint8_t*>(buffer + 48));
+				parseBinaryFacet(buffer, forceNewNormals, disableNewNormals, handler);
 			}
 
 			return Result::Success;
 		}
 
+		static Result parseBinaryFacetCount(const char buffer[4], uint32_t& facetCount)
+		{
+			memcpy(&facetCount, buffer, 4);
+			if (facetCount == 0)
+				return Result::MissingDataError;
+			if (facetCount > BINARY_FACET_LIMIT)
+				return Result::FacetCountError;
+			return Result::Undefined;
+		}
+
+		static void parseBinaryFacet(const char buffer[50], bool forceNewNormals, bool disableNewNormals, Handler& handler)
+		{
+			float values[12];
+			memcpy(values, buffer, 4 * 12);
+			if (forceNewNormals && !disableNewNormals)
+				calculateNormals(values + 3, values + 6, values + 9, values);
+			else if (!disableNewNormals)
+				checkAndFixNormals(values + 3, values + 6, values + 9, values);
+			handler.onFacet(values + 3, values + 6, values + 9, values);
+			if (buffer[48] != 0 || buffer[49] != 0)
+				handler.onFacetAttributes(reinterpret_cast<const uint8_t*>(buffer + 48));
+		}
+
 		// Private helpers to convert a memory buffer into a seekable istream
 		// See source here: https://stackoverflow.com/a/46069245
 		struct membuf : std::streambuf
@@ -455,21 +855,379 @@ namespace microstl
 				return gptr() - eback();
 			}
 		};
-	};
 
-	class Writer
-	{
-	public:
-		// Provider that must be implemented configure options and provide data when writing STL files
-		class Provider
+		// Returns the number of remaining bytes of a seekable stream buffer or UNKNOWN_SIZE for forward-only sources
+		static uint64_t getRemainingSize(std::streambuf& buf)
 		{
-		public:
-			virtual ~Provider() {}
-
-			// Return true to write an ASCII file, return false to write a binary file
-			virtual bool asciiMode() { return false; }
+			auto pos = buf.pubseekoff(0, std::ios_base::cur, std::ios_base::in);
+			if (pos == std::streampos(-1))
+				return UNKNOWN_SIZE;
+			auto end = buf.pubseekoff(0, std::ios_base::end, std::ios_base::in);
+			buf.pubseekoff(static_cast<std::streamoff>(pos), std::ios_base::beg, std::ios_base::in);
+			if (end == std::streampos(-1) || end < pos)
+				return UNKNOWN_SIZE;
+			return static_cast<uint64_t>(end - pos);
+		}
 
-			// Can be used to supply an name for ASCII STL files
+		// Stream buffer that sniffs the start of another stream buffer for the format detection and replays it afterwards.
+		// This works for forward-only sources like pipes or sockets, since no seeking back is required.
+		// No data behind the end of the STL data is consumed from the source, as long as it is not part of the sniffed prefix.
+		// Binary data is read in chunks capped at the size from the header, ASCII data of unknown size is read unbuffered.
+		struct replaybuf : std::streambuf
+		{
+			replaybuf(std::streambuf* src) : source(src)
+			{
+				uint64_t totalSize = UNKNOWN_SIZE;
+				size_t prefixSize = 0;
+				if (source)
+				{
+					totalSize = getRemainingSize(*source);
+					prefixSize = static_cast<size_t>(std::max<std::streamsize>(source->sgetn(buffer.data(), DETECTION_SIZE), 0));
+				}
+				asciiMode = isAsciiFormat(buffer.data(), prefixSize, totalSize);
+
+				remaining = totalSize;
+				if (!asciiMode && prefixSize >= 84)
+				{
+					uint32_t facetCount = 0;
+					memcpy(&facetCount, buffer.data() + 80, 4);
+					remaining = std::min(remaining, 84 + 50 * static_cast<uint64_t>(facetCount));
+				}
+				if (remaining != UNKNOWN_SIZE && remaining < prefixSize)
+				{
+					// Hand back the sniffed bytes behind the end of the data if the source allows it
+					auto offset = static_cast<std::streamoff>(remaining) - static_cast<std::streamoff>(prefixSize);
+					if (source->pubseekoff(offset, std::ios_base::cur, std::ios_base::in) != std::streampos(-1))
+						prefixSize = static_cast<size_t>(remaining);
+				}
+				remaining = remaining == UNKNOWN_SIZE ? UNKNOWN_SIZE : remaining - std::min<uint64_t>(remaining, prefixSize);
+				setg(buffer.data(), buffer.data(), buffer.data() + prefixSize);
+			}
+
+			int_type underflow() override
+			{
+				if (gptr() != egptr())
+					return traits_type::to_int_type(*gptr());
+				if (!source)
+					return traits_type::eof();
+				if (remaining == UNKNOWN_SIZE)
+					return source->sgetc();
+				std::streamsize count = 0;
+				if (remaining > 0)
+					count = source->sgetn(buffer.data(), static_cast<std::streamsize>(std::min<uint64_t>(remaining, buffer.size())));
+				if (count <= 0)
+					return traits_type::eof();
+				remaining -= static_cast<uint64_t>(count);
+				setg(buffer.data(), buffer.data(), buffer.data() + count);
+				return traits_type::to_int_type(buffer[0]);
+			}
+
+			int_type uflow() override
+			{
+				if (gptr() == egptr() && source && remaining == UNKNOWN_SIZE)
+					return source->sbumpc();
+				return std::streambuf::uflow();
+			}
+
+			std::streamsize xsgetn(char* s, std::streamsize count) override
+			{
+				std::streamsize total = 0;
+				while (total < count)
+				{
+					if (gptr() == egptr())
+					{
+						// Large reads and reads of unknown size bypass the internal buffer
+						if (source && remaining == UNKNOWN_SIZE)
+							return total + std::max<std::streamsize>(source->sgetn(s + total, count - total), 0);
+						if (source && count - total >= static_cast<std::streamsize>(buffer.size()))
+						{
+							auto size = static_cast<std::streamsize>(std::min<uint64_t>(remaining, static_cast<uint64_t>(count - total)));
+							size = size > 0 ? std::max<std::streamsize>(source->sgetn(s + total, size), 0) : 0;
+							remaining -= static_cast<uint64_t>(size);
+							return total + size;
+						}
+						if (traits_type::eq_int_type(underflow(), traits_type::eof()))
+							break;
+					}
+					std::streamsize size = std::min<std::streamsize>(egptr() - gptr(), count - total);
+					memcpy(s + total, gptr(), static_cast<size_t>(size));
+					gbump(static_cast<int>(size));
+					total += size;
+				}
+				return total;
+			}
+
+			std::streambuf* source = nullptr;
+			bool asciiMode = false;
+			uint64_t remaining = UNKNOWN_SIZE;
+			std::array<char, 4096> buffer;
+		};
+		struct replaystream : virtual replaybuf, std::istream
+		{
+			replaystream(std::istream& is) : replaybuf(is ? is.rdbuf() : nullptr), std::istream(static_cast<std::streambuf*>(this)) {}
+		};
+
+	public:
+		// Push based parser for STL data that arrives in chunks, for example from a network connection.
+		// Facets are passed to the handler as soon as they are complete, no seeking or buffering of the whole data is needed.
+		class StreamingParser
+		{
+		public:
+			// The optional total size of the data, for example from a Content-Length header, improves the format detection
+			StreamingParser(Handler& targetHandler, uint64_t totalDataSize = UNKNOWN_SIZE) : handler(targetHandler), totalSize(totalDataSize) {}
+
+			// Feed the next chunk of data. Returns Result::Undefined while the parsing continues.
+			// Any other value is the final result, any further data will be ignored.
+			// The progress is reported to the handler after each chunk.
+			Result feed(const char* data, size_t size)
+			{
+				bytesFed += size;
+				Result r = feedChunk(data, size);
+				if (r == Result::Undefined && (mode == Mode::Ascii || mode == Mode::Binary))
+				{
+					uint64_t facets = mode == Mode::Ascii ? asciiState.facetCount : facetsRead;
+					if (!handler.onProgress(bytesFed, facets))
+						return end(Result::Cancelled);
+				}
+				return r;
+			}
+
+			// Signals the end of the data and returns the final result
+			Result finish()
+			{
+				if (mode == Mode::Detecting)
+				{
+					begin();
+					std::vector<char> prefix;
+					prefix.swap(pending);
+					Result result = process(prefix.data(), prefix.size());
+					if (result != Result::Undefined)
+						return result;
+				}
+
+				if (mode == Mode::Ascii)
+				{
+					if (!line.empty())
+					{
+						asciiState.lineNumber++;
+						Result result = parseAsciiLine(asciiState, line, handler);
+						if (result != Result::Undefined)
+							return end(result);
+					}
+					return end(finishAscii(asciiState));
+				}
+				else if (mode == Mode::Binary)
+				{
+					return end(Result::MissingDataError);
+				}
+
+				return result;
+			}
+
+		private:
+			enum class Mode { Detecting, Ascii, Binary, Done };
+
+			Handler& handler;
+			uint64_t totalSize = UNKNOWN_SIZE;
+			Mode mode = Mode::Detecting;
+			Result result = Result::Undefined;
+			std::vector<char> pending;
+			uint64_t bytesFed = 0;
+
+			// ASCII state
+			AsciiState asciiState;
+			std::string line;
+
+			// Binary state
+			size_t position = 0;
+			uint32_t facetCount = 0;
+			uint32_t facetsRead = 0;
+			bool forceNewNormals = false;
+			bool disableNewNormals = false;
+
+			void begin()
+			{
+				bool asciiMode = isAsciiFormat(pending.data(), pending.size(), totalSize);
+				handler.onBegin(asciiMode);
+				if (asciiMode)
+				{
+					mode = Mode::Ascii;
+					asciiState.forceNewNormals = handler.forceRecalculateNormals();
+					asciiState.disableNewNormals = handler.disableRecalculateNormals();
+				}
+				else
+				{
+					mode = isLittleEndian() ? Mode::Binary : Mode::Done;
+					if (mode == Mode::Done)
+						end(Result::EndianError);
+				}
+			}
+
+			Result end(Result r)
+			{
+				if (mode != Mode::Done || result == Result::Undefined)
+				{
+					mode = Mode::Done;
+					result = r;
+					handler.onEnd(result);
+				}
+				return result;
+			}
+
+			Result feedChunk(const char* data, size_t size)
+			{
+				if (mode == Mode::Detecting)
+				{
+					// Collect enough data for the format detection
+					size_t missing = DETECTION_SIZE - pending.size();
+					size_t count = std::min(missing, size);
+					pending.insert(pending.end(), data, data + count);
+					data += count;
+					size -= count;
+					if (pending.size() < DETECTION_SIZE)
+						return Result::Undefined;
+
+					begin();
+					std::vector<char> prefix;
+					prefix.swap(pending);
+					Result result = process(prefix.data(), prefix.size());
+					if (result != Result::Undefined)
+						return result;
+				}
+
+				return process(data, size);
+			}
+
+			Result process(const char* data, size_t size)
+			{
+				if (mode == Mode::Ascii)
+					return processAscii(data, size);
+				else if (mode == Mode::Binary)
+					return processBinary(data, size);
+				return result;
+			}
+
+			Result processAscii(const char* data, size_t size)
+			{
+				for (size_t i = 0; i < size; i++)
+				{
+					if (data[i] == '\n')
+					{
+						asciiState.lineNumber++;
+						Result r = parseAsciiLine(asciiState, line, handler);
+						if (r != Result::Undefined)
+							return end(r);
+						line.resize(0);
+					}
+					else if (line.size() > ASCII_LINE_LIMIT)
+					{
+						asciiState.lineNumber++;
+						handler.onError(asciiState.lineNumber);
+						return end(Result::LineLimitError);
+					}
+					else
+					{
+						line.push_back(data[i]);
+					}
+				}
+				return Result::Undefined;
+			}
+
+			Result processBinary(const char* data, size_t size)
+			{
+				while (size > 0)
+				{
+					// Header and facet count are collected in the pending buffer
+					if (position < 84)
+					{
+						size_t count = std::min<size_t>(84 - position, size);
+						pending.insert(pending.end(), data, data + count);
+						position += count;
+						data += count;
+						size -= count;
+						if (position < 84)
+							return Result::Undefined;
+
+						handler.onBinaryHeader(reinterpret_cast<const uint8_t*>(pending.data()));
+						Result r = parseBinaryFacetCount(pending.data() + 80, facetCount);
+						if (r != Result::Undefined)
+							return end(r);
+						handler.onFacetCount(facetCount);
+						forceNewNormals = handler.forceRecalculateNormals();
+						disableNewNormals = handler.disableRecalculateNormals();
+						pending.clear();
+						continue;
+					}
+
+					// Complete a facet that was split between two chunks
+					if (!pending.empty())
+					{
+						size_t count = std::min<size_t>(50 - pending.size(), size);
+						pending.insert(pending.end(), data, data + count);
+						data += count;
+						size -= count;
+						if (pending.size() < 50)
+							return Result::Undefined;
+						parseBinaryFacet(pending.data(), forceNewNormals, disableNewNormals, handler);
+						pending.clear();
+						if (++facetsRead == facetCount)
+							return end(Result::Success);
+					}
+
+					// Parse complete facets directly from the chunk
+					while (size >= 50)
+					{
+						parseBinaryFacet(data, forceNewNormals, disableNewNormals, handler);
+						data += 50;
+						size -= 50;
+						if (++facetsRead == facetCount)
+							return end(Result::Success);
+					}
+					pending.insert(pending.end(), data, data + size);
+					size = 0;
+				}
+				return Result::Undefined;
+			}
+		};
+	};
+
+	// Options for the templated writer functions that take meshes directly instead of a provider
+	struct WriteOptions
+	{
+		bool ascii = false;
+		bool clearNormals = false;
+
+		// Optional callback that works like Writer::Provider::onProgress(), return false to cancel the writing
+		std::function<bool(uint64_t bytes, uint64_t facets)> onProgress;
+	};
+
+	// Access to the facets of a data source for the templated writer functions.
+	// By default the non-virtual methods getFacetCount() and getFacet() of the source are used,
+	// so they can be inlined. Specializations for Mesh and FVMesh read the mesh storage directly.
+	template<typename T>
+	struct FacetAccess
+	{
+		static size_t getFacetCount(const T& source) { return source.getFacetCount(); }
+
+		static void getFacet(const T& source, size_t index, float v1[3], float v2[3], float v3[3], float n[3])
+		{
+			source.getFacet(index, v1, v2, v3, n);
+		}
+	};
+
+	class Writer
+	{
+	public:
+		// Provider that must be implemented configure options and provide data when writing STL files
+		class Provider
+		{
+		public:
+			virtual ~Provider() {}
+
+			// Return true to write an ASCII file, return false to write a binary file
+			virtual bool asciiMode() { return false; }
+
+			// Can be used to supply an name for ASCII STL files
 			virtual std::string getName() { return libraryName; }
 
 			// Can be used to provide a custom 80 byte header for binary STL files
@@ -493,8 +1251,19 @@ namespace microstl
 			/// Will be called once for each facet/triangle after getFacet() if writeAttributes() is true
 			// The array attributes is an output parameter
 			virtual void getFacetAttributes(size_t index, uint8_t attributes[2]) { memset(attributes, 0, 2); }
+
+			// Return true if getFacet() and getFacetAttributes() can be called concurrently from multiple threads
+			virtual bool threadSafe() { return false; }
+
+			// Called every PROGRESS_INTERVAL facets with the number of bytes and facets written so far.
+			// Return false to stop the writing, which then ends with Result::Cancelled and leaves an incomplete file.
+			// The parallel writer calls it from its worker threads, but never concurrently.
+			virtual bool onProgress(uint64_t bytes, uint64_t facets) { return true; }
 		};
 
+		// Number of facets between two progress reports, the binary writers encode blocks of this size
+		static inline const size_t PROGRESS_INTERVAL = 4096u;
+
 		// Write STL file directly to disk using an UTF8 or ASCII path
 		static Result writeStlFile(const char* utf8FilePath, Provider& provider)
 		{
@@ -509,16 +1278,139 @@ namespace microstl
 			return writeStlFile(path, provider);
 		}
 
-		// Write STL file directly to disk using a std::filesystem path
+		// Write STL file directly to disk using a std::filesystem path.
+		// On POSIX systems binary files are preallocated, memory mapped and the facets are encoded straight into the mapping.
 		static Result writeStlFile(const std::filesystem::path& filePath, Provider& provider)
 		{
+#ifndef _WIN32
+			if (!provider.asciiMode() && isLittleEndian())
+			{
+				size_t facetCount = provider.getFacetCount();
+				bool nullifyNormals = provider.nullifyNormals();
+				bool writeAttributes = provider.writeAttributes();
+				Result result = Result::Undefined;
+				bool mapped = writeMapped(filePath, 84 + 50 * static_cast<uint64_t>(facetCount), [&](char* data)
+				{
+					provider.getHeader(reinterpret_cast<uint8_t*>(data));
+					uint32_t count = static_cast<uint32_t>(facetCount);
+					memcpy(data + 80, &count, 4);
+					for (size_t first = 0; first < facetCount; first += PROGRESS_INTERVAL)
+					{
+						size_t last = std::min(first + PROGRESS_INTERVAL, facetCount);
+						for (size_t i = first; i < last; ++i)
+							encodeBinaryFacet(provider, i, nullifyNormals, writeAttributes, data + 84 + 50 * i);
+						if (!provider.onProgress(84 + 50 * static_cast<uint64_t>(last), last))
+							return false;
+					}
+					return true;
+				}, result);
+				if (mapped)
+					return result;
+			}
+#endif
 			std::ofstream ofs(filePath, std::ios::binary);
 			if (!ofs)
 				return Result::FileError;
-			else
-				return writeStlStream(ofs, provider);
+			Result result = writeStlStream(ofs, provider);
+			ofs.flush();
+			return result == Result::Success && !ofs ? Result::FileError : result;
 		};
 
+		// Write a binary STL file with multiple threads that encode disjoint facet ranges and write them with positional writes.
+		// The file is preallocated to its final size first. ASCII files, providers that are not thread-safe
+		// and platforms without positional writes fall back to writeStlFile(). A thread count of zero will use all hardware threads.
+		// Exceptions thrown by the provider are rethrown after all threads have finished and the file was closed.
+		static Result writeStlFileParallel(const std::filesystem::path& filePath, Provider& provider, size_t threadCount = 0)
+		{
+#ifndef _WIN32
+			if (provider.asciiMode() || !provider.threadSafe())
+				return writeStlFile(filePath, provider);
+			if (!isLittleEndian())
+				return Result::EndianError;
+
+			int fd = ::open(filePath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+			if (fd < 0)
+				return Result::FileError;
+
+			// Each facet lands at a fixed offset behind the header
+			size_t facetCount = provider.getFacetCount();
+			off_t fileSize = static_cast<off_t>(84 + 50 * static_cast<uint64_t>(facetCount));
+			bool ok = preallocate(fd, fileSize) == 0 || ftruncate(fd, fileSize) == 0;
+
+			char header[84];
+			try
+			{
+				provider.getHeader(reinterpret_cast<uint8_t*>(header));
+			}
+			catch (...)
+			{
+				::close(fd);
+				throw;
+			}
+			uint32_t count = static_cast<uint32_t>(facetCount);
+			memcpy(header + 80, &count, 4);
+			ok = ok && writeAt(fd, header, sizeof(header), 0);
+
+			const size_t blockSize = 16384;
+			const size_t blockCount = (facetCount + blockSize - 1) / blockSize;
+			if (threadCount == 0)
+				threadCount = std::max<size_t>(1, std::thread::hardware_concurrency());
+			threadCount = std::max<size_t>(1, std::min(threadCount, blockCount));
+			bool nullifyNormals = provider.nullifyNormals();
+			bool writeAttributes = provider.writeAttributes();
+			std::atomic<size_t> nextBlock(0);
+			std::atomic<bool> failed(!ok);
+			std::atomic<bool> cancelled(false);
+			std::mutex progressMutex;
+			size_t facetsWritten = 0;
+			std::exception_ptr exception;
+			auto worker = [&]()
+			{
+				try
+				{
+					std::vector<char> buffer(blockSize * 50);
+					for (size_t block = nextBlock++; block < blockCount && !failed && !cancelled; block = nextBlock++)
+					{
+						size_t first = block * blockSize;
+						size_t last = std::min(first + blockSize, facetCount);
+						for (size_t i = first; i < last; i++)
+							encodeBinaryFacet(provider, i, nullifyNormals, writeAttributes, buffer.data() + (i - first) * 50);
+						if (!writeAt(fd, buffer.data(), (last - first) * 50, 84 + 50 * static_cast<uint64_t>(first)))
+							failed = true;
+
+						std::lock_guard<std::mutex> lock(progressMutex);
+						facetsWritten += last - first;
+						if (!failed && !cancelled && !provider.onProgress(84 + 50 * static_cast<uint64_t>(facetsWritten), facetsWritten))
+							cancelled = true;
+					}
+				}
+				catch (...)
+				{
+					// Stop the other workers and rethrow after all of them have finished
+					std::lock_guard<std::mutex> lock(progressMutex);
+					if (!exception)
+						exception = std::current_exception();
+					failed = true;
+				}
+			};
+			std::vector<std::thread> threads;
+			for (size_t t = 1; t < threadCount; t++)
+				threads.emplace_back(worker);
+			worker();
+			for (auto& thread : threads)
+				thread.join();
+
+			if (::close(fd) != 0)
+				failed = true;
+			if (exception)
+				std::rethrow_exception(exception);
+			return failed ? Result::FileError : (cancelled ? Result::Cancelled : Result::Success);
+#else
+			(void)threadCount;
+			return writeStlFile(filePath, provider);
+#endif
+		}
+
 		// Write STL file data to a memory buffer
 		static Result writeStlBuffer(std::string& buffer, Provider& provider)
 		{
@@ -536,9 +1428,128 @@ namespace microstl
 			return result;
 		}
 
+		// Write a mesh or any other source with a FacetAccess implementation directly to disk.
+		// Unlike the provider based functions there are no virtual calls per facet.
+		template<typename T>
+		static Result writeMeshFile(const std::filesystem::path& filePath, const T& source, const WriteOptions& options = WriteOptions())
+		{
+#ifndef _WIN32
+			if (!options.ascii && isLittleEndian())
+			{
+				size_t facetCount = FacetAccess<T>::getFacetCount(source);
+				Result result = Result::Undefined;
+				bool mapped = writeMapped(filePath, 84 + 50 * static_cast<uint64_t>(facetCount), [&](char* data)
+				{
+					memset(data, 0, 80);
+					memcpy(data, libraryName, strlen(libraryName));
+					uint32_t count = static_cast<uint32_t>(facetCount);
+					memcpy(data + 80, &count, 4);
+					for (size_t first = 0; first < facetCount; first += PROGRESS_INTERVAL)
+					{
+						size_t last = std::min(first + PROGRESS_INTERVAL, facetCount);
+						encodeMeshFacets(source, first, last, options.clearNormals, data + 84 + 50 * first);
+						if (!reportProgress(options, last))
+							return false;
+					}
+					return true;
+				}, result);
+				if (mapped)
+					return result;
+			}
+#endif
+			std::ofstream ofs(filePath, std::ios::binary);
+			if (!ofs)
+				return Result::FileError;
+			Result result = writeMeshStream(ofs, source, options);
+			ofs.flush();
+			return result == Result::Success && !ofs ? Result::FileError : result;
+		}
+
+		// Write a mesh or any other source with a FacetAccess implementation to a memory buffer
+		template<typename T>
+		static Result writeMeshBuffer(std::string& buffer, const T& source, const WriteOptions& options = WriteOptions())
+		{
+			std::ostringstream ss;
+			Result result = writeMeshStream(ss, source, options);
+			buffer = ss.str();
+			return result;
+		}
+
+		// Write a mesh or any other source with a FacetAccess implementation to a std::ostream.
+		// Binary facets are encoded from the source into blocks that are written at once.
+		template<typename T>
+		static Result writeMeshStream(std::ostream& os, const T& source, const WriteOptions& options = WriteOptions())
+		{
+			if (options.ascii)
+			{
+				AccessProvider<T> provider(source, options);
+				return writeAsciiStream(os, provider);
+			}
+			if (!isLittleEndian())
+				return Result::EndianError;
+
+			char header[84] = { 0, };
+			memcpy(header, libraryName, strlen(libraryName));
+			size_t facetCount = FacetAccess<T>::getFacetCount(source);
+			uint32_t count = static_cast<uint32_t>(facetCount);
+			memcpy(header + 80, &count, 4);
+			os.write(header, sizeof(header));
+
+			std::vector<char> buffer(std::min(facetCount, PROGRESS_INTERVAL) * 50);
+			for (size_t first = 0; first < facetCount; first += PROGRESS_INTERVAL)
+			{
+				size_t last = std::min(first + PROGRESS_INTERVAL, facetCount);
+				encodeMeshFacets(source, first, last, options.clearNormals, buffer.data());
+				os.write(buffer.data(), (last - first) * 50);
+				if (!reportProgress(options, last))
+					return Result::Cancelled;
+			}
+			return Result::Success;
+		}
+
 	private:
 		static inline const char* libraryName = "microstl";
 
+		// Calls the optional progress callback of the templated writers after a block of binary facets
+		static bool reportProgress(const WriteOptions& options, size_t facets)
+		{
+			return !options.onProgress || options.onProgress(84 + 50 * static_cast<uint64_t>(facets), facets);
+		}
+
+		// Encode a range of binary facets of a templated source
+		template<typename T>
+		static void encodeMeshFacets(const T& source, size_t first, size_t last, bool clearNormals, char* output)
+		{
+			for (size_t i = first; i < last; i++, output += 50)
+			{
+				float v[12];
+				FacetAccess<T>::getFacet(source, i, v + 3, v + 6, v + 9, v);
+				if (clearNormals)
+					v[0] = v[1] = v[2] = 0.0f;
+				memcpy(output, v, sizeof(v));
+				output[48] = output[49] = 0;
+			}
+		}
+
+		// Adapter for the templated sources to share the ASCII writer
+		template<typename T>
+		struct AccessProvider : Provider
+		{
+			const T& source;
+			const WriteOptions& options;
+
+			AccessProvider(const T& s, const WriteOptions& o) : source(s), options(o) {}
+			bool asciiMode() override { return options.ascii; }
+			bool nullifyNormals() override { return options.clearNormals; }
+			size_t getFacetCount() override { return FacetAccess<T>::getFacetCount(source); }
+			bool onProgress(uint64_t bytes, uint64_t facets) override { return !options.onProgress || options.onProgress(bytes, facets); }
+
+			void getFacet(size_t index, float v1[3], float v2[3], float v3[3], float n[3]) override
+			{
+				FacetAccess<T>::getFacet(source, index, v1, v2, v3, n);
+			}
+		};
+
 		static bool isLittleEndian()
 		{
 			int16_t number = 1;
@@ -556,8 +1567,17 @@ namespace microstl
 
 			size_t facetCount = provider.getFacetCount();
 			bool nullifyNormals = provider.nullifyNormals();
+			const std::streampos start = os.tellp();
 			for (size_t i = 0; i < facetCount; ++i)
 			{
+				if (i > 0 && i % PROGRESS_INTERVAL == 0)
+				{
+					// Streams without positions report zero bytes
+					const std::streampos position = os.tellp();
+					uint64_t bytes = start != std::streampos(-1) && position != std::streampos(-1) ? static_cast<uint64_t>(position - start) : 0;
+					if (!provider.onProgress(bytes, i))
+						return Result::Cancelled;
+				}
 				float n[3] = { 0, };
 				float v[9] = { 0, };
 				provider.getFacet(i, v + 0, v + 3, v + 6, n);
@@ -589,27 +1609,132 @@ namespace microstl
 			uint32_t tmp = static_cast<uint32_t>(facetCount);
 			os.write(reinterpret_cast<char*>(&tmp), 4);
 
-			float nullNormals[3] = { 0 ,0,0 };
 			bool nullifyNormals = provider.nullifyNormals();
 			bool writeAttributes = provider.writeAttributes();
-			for (size_t i = 0; i < facetCount; ++i)
+			std::vector<char> block(std::min(facetCount, PROGRESS_INTERVAL) * 50);
+			for (size_t first = 0; first < facetCount; first += PROGRESS_INTERVAL)
 			{
-				float n[3] = { 0, };
-				float v[9] = { 0, };
-				provider.getFacet(i, v + 0, v + 3, v + 6, n);
-				if (nullifyNormals)
-					os.write(reinterpret_cast<char*>(nullNormals), 3 * sizeof(float));
-				else
-					os.write(reinterpret_cast<char*>(n), 3 * sizeof(float));
-				os.write(reinterpret_cast<char*>(v), 9 * sizeof(float));
-				uint8_t a[2] = { 0, 0 };
-				if (writeAttributes)
-					provider.getFacetAttributes(i, a);
-				os.write(reinterpret_cast<char*>(a), 2);
+				size_t last = std::min(first + PROGRESS_INTERVAL, facetCount);
+				for (size_t i = first; i < last; ++i)
+					encodeBinaryFacet(provider, i, nullifyNormals, writeAttributes, block.data() + (i - first) * 50);
+				os.write(block.data(), (last - first) * 50);
+				if (!provider.onProgress(84 + 50 * static_cast<uint64_t>(last), last))
+					return Result::Cancelled;
 			}
 
 			return Result::Success;
 		}
+
+		static void encodeBinaryFacet(Provider& provider, size_t index, bool nullifyNormals, bool writeAttributes, char output[50])
+		{
+			float n[3] = { 0, };
+			float v[9] = { 0, };
+			provider.getFacet(index, v + 0, v + 3, v + 6, n);
+			if (nullifyNormals)
+				n[0] = n[1] = n[2] = 0.0f;
+			uint8_t a[2] = { 0, 0 };
+			if (writeAttributes)
+				provider.getFacetAttributes(index, a);
+			memcpy(output, n, 3 * sizeof(float));
+			memcpy(output + 12, v, 9 * sizeof(float));
+			memcpy(output + 48, a, 2);
+		}
+
+#ifndef _WIN32
+		// Create a file of the given size, map it and call encode() with the mapping to fill it, encode() returns false when cancelled.
+		// The blocks are reserved with preallocate() first, so a full disk or an exceeded file size limit
+		// results in a FileError instead of SIGBUS. Returns false without creating the data if the file system
+		// or file type does not support this, the caller should then fall back to a stream.
+		template<typename Encode>
+		static bool writeMapped(const std::filesystem::path& filePath, uint64_t size, Encode&& encode, Result& result)
+		{
+			if (size > std::numeric_limits<size_t>::max())
+				return false;
+
+			// Unmaps and closes the file also when encode() throws
+			struct MappedFile
+			{
+				int fd = -1;
+				void* data = MAP_FAILED;
+				size_t size = 0;
+				~MappedFile() { release(); }
+				bool release()
+				{
+					bool ok = data == MAP_FAILED || munmap(data, size) == 0;
+					ok = (fd < 0 || ::close(fd) == 0) && ok;
+					data = MAP_FAILED;
+					fd = -1;
+					return ok;
+				}
+			};
+
+			MappedFile file;
+			file.fd = ::open(filePath.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+			if (file.fd < 0)
+			{
+				result = Result::FileError;
+				return true;
+			}
+			int error = preallocate(file.fd, static_cast<off_t>(size));
+			if (error != 0)
+			{
+				result = Result::FileError;
+				return error != EINVAL && error != EOPNOTSUPP && error != ENOTSUP && error != ENODEV && error != ESPIPE;
+			}
+			file.size = static_cast<size_t>(size);
+			file.data = mmap(nullptr, file.size, PROT_READ | PROT_WRITE, MAP_SHARED, file.fd, 0);
+			if (file.data == MAP_FAILED)
+				return false;
+			bool completed = encode(static_cast<char*>(file.data));
+			bool ok = msync(file.data, file.size, MS_SYNC) == 0;
+			ok = file.release() && ok;
+			result = !ok ? Result::FileError : (completed ? Result::Success : Result::Cancelled);
+			return true;
+		}
+
+		// Reserves the blocks of a file and sets its size, returns zero or an error number like posix_fallocate().
+		// macOS has no posix_fallocate(), there the blocks are reserved with F_PREALLOCATE before setting the size.
+		static int preallocate(int fd, off_t size)
+		{
+#ifdef __APPLE__
+			if (size > 0)
+			{
+				fstore_t store = {};
+				store.fst_flags = F_ALLOCATECONTIG | F_ALLOCATEALL;
+				store.fst_posmode = F_PEOFPOSMODE;
+				store.fst_offset = 0;
+				store.fst_length = size;
+				if (fcntl(fd, F_PREALLOCATE, &store) == -1)
+				{
+					// Retry without requiring contiguous blocks
+					store.fst_flags = F_ALLOCATEALL;
+					if (fcntl(fd, F_PREALLOCATE, &store) == -1)
+						return errno;
+				}
+			}
+			return ftruncate(fd, size) == 0 ? 0 : errno;
+#else
+			return posix_fallocate(fd, 0, size);
+#endif
+		}
+
+		// Positional write that continues after partial writes
+		static bool writeAt(int fd, const char* data, size_t size, uint64_t offset)
+		{
+			while (size > 0)
+			{
+				ssize_t written = ::pwrite(fd, data, size, static_cast<off_t>(offset));
+				if (written < 0 && errno == EINTR)
+					continue;
+				if (written <= 0)
+					return false;
+				data += written;
+				size -= static_cast<size_t>(written);
+				offset += static_cast<uint64_t>(written);
+			}
+			return true;
+		}
+#endif
 	};
 
 	// Converts the result enum values to readable strings
@@ -619,7 +1744,7 @@ namespace microstl
 			throw std::runtime_error("Invalid result value!");
 
 		static_assert(sizeof(Result) == sizeof(uint16_t), "Please adjust the code below with new type!");
-		const uint16_t knowLastValue = 9u;
+		const uint16_t knowLastValue = 11u;
 		const uint16_t currentLastValue = static_cast<uint16_t>(Result::__LAST__RESULT__VALUE);
 		static_assert(knowLastValue == currentLastValue, "Please extend the switch cases!");
 		switch (result)
@@ -642,29 +1767,187 @@ namespace microstl
 			return "FacetCountError";
 		case microstl::Result::EndianError:
 			return "EndianError";
+		case microstl::Result::CacheFormatError:
+			return "CacheFormatError";
+		case microstl::Result::Cancelled:
+			return "Cancelled";
 		default:
 			throw std::runtime_error("Invalid result value!");
 		}
 	}
 
 	// Simple data structures for meshes
+	// The containers use the allocator template given to BasicMesh and BasicFVMesh, Mesh and FVMesh use std::allocator.
+	// The types in microstl::pmr use std::pmr::polymorphic_allocator to allow arena allocations.
 	struct Normal { float x, y, z; };
 	struct Vertex { float x, y, z; };
 
 	// Each facet contains a copy of all three vertex coordinates
 	struct Facet { Vertex v1; Vertex v2; Vertex v3; Normal n; };
-	struct Mesh { std::vector<Facet> facets; };
+	template<template<typename> class Allocator = std::allocator>
+	struct BasicMesh
+	{
+		using allocator_type = Allocator<std::byte>;
+
+		std::vector<Facet, Allocator<Facet>> facets;
+
+		// Facets with normals that still have to be recalculated when reading with lazy normals.
+		// Empty if all normals are valid, use fixNormals() or getFacetNormal() to access the correct normals.
+		// The flags may be shorter than the facets, facets without a flag like appended ones are not pending.
+		std::vector<bool, Allocator<bool>> pendingNormals;
+
+		BasicMesh() {}
+		explicit BasicMesh(const allocator_type& allocator) : facets(allocator), pendingNormals(allocator) {}
+	};
+	using Mesh = BasicMesh<>;
 
 	// Each facet has three vertex indices
 	struct FVFacet { size_t v1; size_t v2; size_t v3; Normal n; };
-	struct FVMesh { std::vector<Vertex> vertices; std::vector<FVFacet> facets; };
+	template<template<typename> class Allocator = std::allocator>
+	struct BasicFVMesh
+	{
+		using allocator_type = Allocator<std::byte>;
+
+		std::vector<Vertex, Allocator<Vertex>> vertices;
+		std::vector<FVFacet, Allocator<FVFacet>> facets;
+
+		// Facets with normals that still have to be recalculated, see Mesh::pendingNormals
+		std::vector<bool, Allocator<bool>> pendingNormals;
+
+		BasicFVMesh() {}
+		explicit BasicFVMesh(const allocator_type& allocator) : vertices(allocator), facets(allocator), pendingNormals(allocator) {}
+	};
+	using FVMesh = BasicFVMesh<>;
+
+	// Hash table that maps equal vertices to their index in a vertex list, used for the vertex deduplication.
+	// Negative zero is treated like positive zero and vertices with NaN coordinates are never merged.
+	template<template<typename> class Allocator = std::allocator>
+	class BasicVertexIndexTable
+	{
+	public:
+		BasicVertexIndexTable(const Allocator<uint32_t>& allocator = Allocator<uint32_t>()) : slots(allocator) {}
+
+		// Prepare the table for the given number of unique vertices to avoid rehashing
+		template<typename Vertices>
+		void reserve(const Vertices& vertices, size_t vertexCount)
+		{
+			size_t slotCount = 16;
+			while (slotCount < vertexCount * 2)
+				slotCount *= 2;
+			if (slotCount > slots.size())
+				rehash(vertices, slotCount);
+		}
+
+		// Returns the index of an equal vertex inside the list or appends the vertex to the list
+		template<typename Vertices>
+		size_t insert(Vertices& vertices, const Vertex& v)
+		{
+			if (v.x != v.x || v.y != v.y || v.z != v.z)
+			{
+				vertices.push_back(v);
+				return vertices.size() - 1;
+			}
+
+			if ((count + 1) * 2 > slots.size())
+				rehash(vertices, std::max<size_t>(16, slots.size() * 2));
+
+			size_t mask = slots.size() - 1;
+			for (size_t i = hash(v) & mask; ; i = (i + 1) & mask)
+			{
+				uint32_t slot = slots[i];
+				if (slot == 0)
+				{
+					// Slots store the vertex index plus one, zero marks an empty slot
+					if (vertices.size() >= std::numeric_limits<uint32_t>::max())
+						throw std::runtime_error("Too many vertices for deduplication");
+					vertices.push_back(v);
+					slots[i] = static_cast<uint32_t>(vertices.size());
+					count++;
+					return vertices.size() - 1;
+				}
+				const Vertex& other = vertices[slot - 1];
+				if (other.x == v.x && other.y == v.y && other.z == v.z)
+					return slot - 1;
+			}
+		}
+
+		// Release all memory of the table, the vertex list is not affected
+		void clear()
+		{
+			slots.clear();
+			slots.shrink_to_fit();
+			count = 0;
+		}
+
+	private:
+		std::vector<uint32_t, Allocator<uint32_t>> slots;
+		size_t count = 0;
+
+		static uint32_t floatBits(float f)
+		{
+			// Adding zero turns negative zero into positive zero
+			f += 0.0f;
+			uint32_t bits;
+			memcpy(&bits, &f, sizeof(bits));
+			return bits;
+		}
+
+		static size_t hash(const Vertex& v)
+		{
+			uint64_t h = floatBits(v.x) * 0x9E3779B97F4A7C15ull;
+			h ^= floatBits(v.y) * 0xC2B2AE3D27D4EB4Full;
+			h ^= floatBits(v.z) * 0x165667B19E3779F9ull;
+			h ^= h >> 29;
+			h *= 0xBF58476D1CE4E5B9ull;
+			h ^= h >> 32;
+			return static_cast<size_t>(h);
+		}
+
+		template<typename Vertices>
+		void rehash(const Vertices& vertices, size_t slotCount)
+		{
+			slots.assign(slotCount, 0);
+			size_t mask = slotCount - 1;
+			for (size_t index = 0; index < vertices.size(); index++)
+			{
+				const Vertex& v = vertices[index];
+				if (v.x != v.x || v.y != v.y || v.z != v.z)
+					continue;
+				size_t i = hash(v) & mask;
+				while (slots[i] != 0)
+					i = (i + 1) & mask;
+				slots[i] = static_cast<uint32_t>(index + 1);
+			}
+		}
+	};
+	using VertexIndexTable = BasicVertexIndexTable<>;
+
+	// Records the pending flag of the latest facet. The flags are only allocated once the first facet needs a new normal,
+	// so meshes with valid normals keep an empty list.
+	template<typename Flags>
+	void markPendingNormal(Flags& pendingNormals, size_t facetCount, bool needsFix)
+	{
+		if (pendingNormals.empty())
+		{
+			if (!needsFix)
+				return;
+			pendingNormals.assign(facetCount - 1, false);
+		}
+		pendingNormals.push_back(needsFix);
+	}
 
-	struct MeshReaderHandler : Reader::Handler
+	template<template<typename> class Allocator>
+	struct BasicMeshReaderHandler : Reader::Handler
 	{
+		using allocator_type = typename BasicMesh<Allocator>::allocator_type;
+
+		// Allocator for the mesh, name and header data
+		allocator_type allocator;
+
 		// Results
-		Mesh mesh;
-		std::string name;
-		std::vector<uint8_t> header;
+		BasicMesh<Allocator> mesh;
+		std::basic_string<char, std::char_traits<char>, Allocator<char>> name;
+		std::vector<uint8_t, Allocator<uint8_t>> header;
 		bool ascii;
 		size_t errorLineNumber;
 		microstl::Result result;
@@ -672,19 +1955,21 @@ namespace microstl
 		// Settings
 		bool forceNormals = false;
 		bool disableNormals = false;
+		bool lazyNormals = false; // Keep the raw normals and only mark the facets that need new normals in mesh.pendingNormals
 
-		MeshReaderHandler() { clear(); }
-		void onName(const std::string& n) override { name = n; }
+		BasicMeshReaderHandler(const allocator_type& a = allocator_type())
+			: allocator(a), mesh(a), name(a), header(a) { clear(); }
+		void onName(const std::string& n) override { name.assign(n.data(), n.size()); }
 		void onBegin(bool m) override { clear();  ascii = m; }
 		void onBinaryHeader(const uint8_t buffer[80]) override { header.resize(80); memcpy(header.data(), buffer, 80); }
-		bool forceRecalculateNormals() override { return forceNormals; }
-		bool disableRecalculateNormals() override { return disableNormals; }
+		bool forceRecalculateNormals() override { return forceNormals && !lazyNormals; }
+		bool disableRecalculateNormals() override { return disableNormals || lazyNormals; }
 		void onError(size_t l) override { errorLineNumber = l; }
 		void onEnd(Result r) override { result = r; }
 
 		void clear()
 		{
-			mesh = Mesh();
+			mesh = BasicMesh<Allocator>(allocator);
 			name.clear();
 			header.clear();
 			ascii = false;
@@ -700,9 +1985,316 @@ namespace microstl
 			facet.v3 = { v3[0], v3[1], v3[2] };
 			facet.n = { n[0], n[1], n[2] };
 			mesh.facets.push_back(std::move(facet));
+			if (lazyNormals && !disableNormals)
+				markPendingNormal(mesh.pendingNormals, mesh.facets.size(), forceNormals || Reader::needsNormalFix(n));
+		}
+	};
+	struct MeshReaderHandler : BasicMeshReaderHandler<std::allocator> {};
+
+	// Handler that deduplicates the vertices while parsing and creates a face-vertex mesh directly.
+	// This avoids holding the duplicated vertices of all facets in memory like MeshReaderHandler does.
+	template<template<typename> class Allocator>
+	struct BasicFVMeshReaderHandler : Reader::Handler
+	{
+		using allocator_type = typename BasicFVMesh<Allocator>::allocator_type;
+
+		// Allocator for the mesh, name and header data
+		allocator_type allocator;
+
+		// Results
+		BasicFVMesh<Allocator> mesh;
+		std::basic_string<char, std::char_traits<char>, Allocator<char>> name;
+		std::vector<uint8_t, Allocator<uint8_t>> header;
+		bool ascii;
+		size_t errorLineNumber;
+		microstl::Result result;
+
+		// Settings
+		bool forceNormals = false;
+		bool disableNormals = false;
+		bool lazyNormals = false; // Keep the raw normals and only mark the facets that need new normals in mesh.pendingNormals
+
+		BasicFVMeshReaderHandler(const allocator_type& a = allocator_type())
+			: allocator(a), mesh(a), name(a), header(a), table(a) { clear(); }
+		void onName(const std::string& n) override { name.assign(n.data(), n.size()); }
+		void onBegin(bool m) override { clear();  ascii = m; }
+		void onBinaryHeader(const uint8_t buffer[80]) override { header.resize(80); memcpy(header.data(), buffer, 80); }
+		bool forceRecalculateNormals() override { return forceNormals && !lazyNormals; }
+		bool disableRecalculateNormals() override { return disableNormals || lazyNormals; }
+		void onError(size_t l) override { errorLineNumber = l; }
+		void onEnd(Result r) override { result = r; table.clear(); }
+
+		void onFacetCount(uint32_t triangles) override
+		{
+			// Closed meshes have about half as many vertices as facets
+			mesh.facets.reserve(triangles);
+			mesh.vertices.reserve(triangles / 2 + 2);
+			table.reserve(mesh.vertices, triangles / 2 + 2);
+		}
+
+		void clear()
+		{
+			mesh = BasicFVMesh<Allocator>(allocator);
+			table.clear();
+			name.clear();
+			header.clear();
+			ascii = false;
+			errorLineNumber = 0;
+			result = microstl::Result::Undefined;
+		}
+
+		void onFacet(const float v1[3], const float v2[3], const float v3[3], const float n[3]) override
+		{
+			size_t i1 = table.insert(mesh.vertices, Vertex{ v1[0], v1[1], v1[2] });
+			size_t i2 = table.insert(mesh.vertices, Vertex{ v2[0], v2[1], v2[2] });
+			size_t i3 = table.insert(mesh.vertices, Vertex{ v3[0], v3[1], v3[2] });
+			mesh.facets.push_back(FVFacet{ i1, i2, i3, Normal{ n[0], n[1], n[2] } });
+			if (lazyNormals && !disableNormals)
+				markPendingNormal(mesh.pendingNormals, mesh.facets.size(), forceNormals || Reader::needsNormalFix(n));
+		}
+
+	private:
+		BasicVertexIndexTable<Allocator> table;
+	};
+	struct FVMeshReaderHandler : BasicFVMeshReaderHandler<std::allocator> {};
+
+	// Mesh and handler types that allocate from a std::pmr::memory_resource
+	namespace pmr
+	{
+		using Mesh = BasicMesh<std::pmr::polymorphic_allocator>;
+		using FVMesh = BasicFVMesh<std::pmr::polymorphic_allocator>;
+		using MeshReaderHandler = BasicMeshReaderHandler<std::pmr::polymorphic_allocator>;
+		using FVMeshReaderHandler = BasicFVMeshReaderHandler<std::pmr::polymorphic_allocator>;
+	}
+
+	// Returns the normal of a facet and calculates it on demand if it is still pending
+	template<template<typename> class Allocator>
+	Normal getFacetNormal(const BasicMesh<Allocator>& mesh, size_t index)
+	{
+		const Facet& f = mesh.facets[index];
+		if (index >= mesh.pendingNormals.size() || !mesh.pendingNormals[index])
+			return f.n;
+		const float v1[3] = { f.v1.x, f.v1.y, f.v1.z };
+		const float v2[3] = { f.v2.x, f.v2.y, f.v2.z };
+		const float v3[3] = { f.v3.x, f.v3.y, f.v3.z };
+		float n[3];
+		Reader::calculateNormals(v1, v2, v3, n);
+		return Normal{ n[0], n[1], n[2] };
+	}
+
+	template<template<typename> class Allocator>
+	Normal getFacetNormal(const BasicFVMesh<Allocator>& mesh, size_t index)
+	{
+		const FVFacet& f = mesh.facets[index];
+		if (index >= mesh.pendingNormals.size() || !mesh.pendingNormals[index])
+			return f.n;
+		const Vertex& a = mesh.vertices[f.v1];
+		const Vertex& b = mesh.vertices[f.v2];
+		const Vertex& c = mesh.vertices[f.v3];
+		const float v1[3] = { a.x, a.y, a.z };
+		const float v2[3] = { b.x, b.y, b.z };
+		const float v3[3] = { c.x, c.y, c.z };
+		float n[3];
+		Reader::calculateNormals(v1, v2, v3, n);
+		return Normal{ n[0], n[1], n[2] };
+	}
+
+	// Calculates all pending normals in one batch and clears the pending flags
+	template<template<typename> class Allocator>
+	void fixNormals(BasicMesh<Allocator>& mesh)
+	{
+		for (size_t i = 0; i < std::min(mesh.pendingNormals.size(), mesh.facets.size()); i++)
+			if (mesh.pendingNormals[i])
+				mesh.facets[i].n = getFacetNormal(mesh, i);
+		mesh.pendingNormals.clear();
+		mesh.pendingNormals.shrink_to_fit();
+	}
+
+	template<template<typename> class Allocator>
+	void fixNormals(BasicFVMesh<Allocator>& mesh)
+	{
+		for (size_t i = 0; i < std::min(mesh.pendingNormals.size(), mesh.facets.size()); i++)
+			if (mesh.pendingNormals[i])
+				mesh.facets[i].n = getFacetNormal(mesh, i);
+		mesh.pendingNormals.clear();
+		mesh.pendingNormals.shrink_to_fit();
+	}
+
+	// Settings for the validation of facets
+	struct ValidationSettings
+	{
+		float minArea = 0.0f;
+		float minQuality = 0.0f; // Ratio between 0 and 1, where 1 is an equilateral triangle
+		float maxCoordinate = INFINITY;
+	};
+
+	// Checks facets for non-finite values, degenerated or sliver triangles and out of range coordinates
+	class FacetValidator
+	{
+	public:
+		// Issues of a facet as bit flags
+		enum Issue : uint32_t
+		{
+			NoIssue = 0,
+			NonFinite = 1, // NaN or infinite vertex or normal values
+			Degenerated = 2, // Facet area is zero or below the minimum area
+			Sliver = 4, // Facet shape quality is below the minimum quality
+			OutOfRange = 8 // Absolute coordinate value is larger than the maximum coordinate
+		};
+
+		FacetValidator(const ValidationSettings& validationSettings = ValidationSettings()) : settings(validationSettings) {}
+
+		// Returns the issues of a facet, the checks avoid branches so that the compiler can vectorize them
+		uint32_t check(const float v1[3], const float v2[3], const float v3[3], const float n[3]) const
+		{
+			// Any NaN or infinite value turns the sum into NaN
+			float sum = 0.0f;
+			float maxAbs = 0.0f;
+			for (int i = 0; i < 3; i++)
+			{
+				sum += v1[i] * 0.0f + v2[i] * 0.0f + v3[i] * 0.0f + n[i] * 0.0f;
+				maxAbs = std::max({ maxAbs, std::abs(v1[i]), std::abs(v2[i]), std::abs(v3[i]) });
+			}
+			if (sum != sum)
+				return NonFinite;
+
+			float u[3] = { v2[0] - v1[0], v2[1] - v1[1], v2[2] - v1[2] };
+			float v[3] = { v3[0] - v1[0], v3[1] - v1[1], v3[2] - v1[2] };
+			float w[3] = { v3[0] - v2[0], v3[1] - v2[1], v3[2] - v2[2] };
+			float c[3] = { u[1] * v[2] - u[2] * v[1], u[2] * v[0] - u[0] * v[2], u[0] * v[1] - u[1] * v[0] };
+			float area = 0.5f * std::sqrt(c[0] * c[0] + c[1] * c[1] + c[2] * c[2]);
+			float edges = u[0] * u[0] + u[1] * u[1] + u[2] * u[2] + v[0] * v[0] + v[1] * v[1] + v[2] * v[2] + w[0] * w[0] + w[1] * w[1] + w[2] * w[2];
+			float quality = edges > 0.0f ? 6.92820323f * area / edges : 0.0f;
+
+			// Degenerated facets are not counted as slivers too
+			uint32_t issues = NoIssue;
+			issues |= !(area > settings.minArea) ? Degenerated : NoIssue;
+			issues |= area > settings.minArea && quality < settings.minQuality ? Sliver : NoIssue;
+			issues |= maxAbs > settings.maxCoordinate ? OutOfRange : NoIssue;
+			return issues;
+		}
+
+		// Checks the stored normal, use the overload with getFacetNormal() for meshes with pending normals
+		uint32_t check(const Facet& f) const
+		{
+			return check(f, f.n);
+		}
+
+		uint32_t check(const Facet& f, const Normal& normal) const
+		{
+			const float v1[3] = { f.v1.x, f.v1.y, f.v1.z };
+			const float v2[3] = { f.v2.x, f.v2.y, f.v2.z };
+			const float v3[3] = { f.v3.x, f.v3.y, f.v3.z };
+			const float n[3] = { normal.x, normal.y, normal.z };
+			return check(v1, v2, v3, n);
+		}
+
+	private:
+		ValidationSettings settings;
+	};
+
+	// Number of facets with each issue, facets can have multiple issues at once
+	struct ValidationReport
+	{
+		size_t facetCount = 0;
+		size_t invalidFacets = 0;
+		size_t nonFiniteFacets = 0;
+		size_t degeneratedFacets = 0;
+		size_t sliverFacets = 0;
+		size_t outOfRangeFacets = 0;
+
+		bool isValid() const { return invalidFacets == 0; }
+
+		void add(uint32_t issues)
+		{
+			facetCount++;
+			invalidFacets += issues != FacetValidator::NoIssue;
+			nonFiniteFacets += (issues & FacetValidator::NonFinite) != 0;
+			degeneratedFacets += (issues & FacetValidator::Degenerated) != 0;
+			sliverFacets += (issues & FacetValidator::Sliver) != 0;
+			outOfRangeFacets += (issues & FacetValidator::OutOfRange) != 0;
+		}
+	};
+
+	// Handler that validates the facets while parsing and forwards them to another handler.
+	// Invalid facets are either dropped or forwarded and flagged by their index.
+	class ValidatingHandler : public Reader::ForwardingHandler
+	{
+	public:
+		enum class Mode { Drop, Flag };
+
+		ValidationReport report;
+		std::vector<size_t> flaggedFacets; // Indices of invalid facets in the parsed data when flagging them
+
+		ValidatingHandler(Reader::Handler& targetHandler, Mode validationMode = Mode::Drop,
+			const ValidationSettings& settings = ValidationSettings())
+			: ForwardingHandler(targetHandler), mode(validationMode), validator(settings) {}
+
+		void onBegin(bool asciiMode) override
+		{
+			report = ValidationReport();
+			flaggedFacets.clear();
+			target.onBegin(asciiMode);
+		}
+
+		void onFacet(const float v1[3], const float v2[3], const float v3[3], const float n[3]) override
+		{
+			uint32_t issues = validator.check(v1, v2, v3, n);
+			size_t index = report.facetCount;
+			report.add(issues);
+			dropped = issues != FacetValidator::NoIssue && mode == Mode::Drop;
+			if (issues != FacetValidator::NoIssue && mode == Mode::Flag)
+				flaggedFacets.push_back(index);
+			if (!dropped)
+				target.onFacet(v1, v2, v3, n);
+		}
+
+		void onFacetAttributes(const uint8_t attributes[2]) override
+		{
+			if (!dropped)
+				target.onFacetAttributes(attributes);
 		}
+
+	private:
+		Mode mode;
+		FacetValidator validator;
+		bool dropped = false;
 	};
 
+	// Validate all facets of a mesh, the indices of invalid facets are optionally returned
+	template<template<typename> class Allocator>
+	ValidationReport validateMesh(const BasicMesh<Allocator>& mesh, const ValidationSettings& settings = ValidationSettings(),
+		std::vector<size_t>* invalidFacets = nullptr)
+	{
+		FacetValidator validator(settings);
+		ValidationReport report;
+		for (size_t i = 0; i < mesh.facets.size(); i++)
+		{
+			uint32_t issues = validator.check(mesh.facets[i], getFacetNormal(mesh, i));
+			report.add(issues);
+			if (issues != FacetValidator::NoIssue && invalidFacets != nullptr)
+				invalidFacets->push_back(i);
+		}
+		return report;
+	}
+
+	// Remove all invalid facets from a mesh while keeping the order of the remaining facets
+	template<template<typename> class Allocator>
+	ValidationReport removeInvalidFacets(BasicMesh<Allocator>& mesh, const ValidationSettings& settings = ValidationSettings())
+	{
+		fixNormals(mesh);
+		FacetValidator validator(settings);
+		ValidationReport report;
+		auto end = std::remove_if(mesh.facets.begin(), mesh.facets.end(), [&](const Facet& f)
+		{
+			uint32_t issues = validator.check(f);
+			report.add(issues);
+			return issues != FacetValidator::NoIssue;
+		});
+		mesh.facets.erase(end, mesh.facets.end());
+		return report;
+	}
+
 	// The mesh provider can be used to write a mesh using the writer
 	struct MeshProvider : microstl::Writer::Provider
 	{
@@ -714,6 +2306,7 @@ namespace microstl
 		size_t getFacetCount() override { return mesh.facets.size(); }
 		bool asciiMode() override { return ascii; }
 		bool nullifyNormals() override { return clearNormals; }
+		bool threadSafe() override { return true; }
 
 		void getFacet(size_t index, float v1[3], float v2[3], float v3[3], float n[3]) override
 		{
@@ -721,7 +2314,8 @@ namespace microstl
 			v1[0] = facet.v1.x; v1[1] = facet.v1.y; v1[2] = facet.v1.z;
 			v2[0] = facet.v2.x; v2[1] = facet.v2.y; v2[2] = facet.v2.z;
 			v3[0] = facet.v3.x; v3[1] = facet.v3.y; v3[2] = facet.v3.z;
-			n[0] = facet.n.x; n[1] = facet.n.y; n[2] = facet.n.z;
+			Normal normal = getFacetNormal(mesh, index);
+			n[0] = normal.x; n[1] = normal.y; n[2] = normal.z;
 		}
 	};
 
@@ -736,6 +2330,7 @@ namespace microstl
 		size_t getFacetCount() override { return mesh.facets.size(); }
 		bool asciiMode() override { return ascii; }
 		bool nullifyNormals() override { return clearNormals; }
+		bool threadSafe() override { return true; }
 
 		void getFacet(size_t index, float v1[3], float v2[3], float v3[3], float n[3]) override
 		{
@@ -743,36 +2338,3751 @@ namespace microstl
 			v1[0] = mesh.vertices[facet.v1].x; v1[1] = mesh.vertices[facet.v1].y; v1[2] = mesh.vertices[facet.v1].z;
 			v2[0] = mesh.vertices[facet.v2].x; v2[1] = mesh.vertices[facet.v2].y; v2[2] = mesh.vertices[facet.v2].z;
 			v3[0] = mesh.vertices[facet.v3].x; v3[1] = mesh.vertices[facet.v3].y; v3[2] = mesh.vertices[facet.v3].z;
-			n[0] = facet.n.x; n[1] = facet.n.y; n[2] = facet.n.z;
+			Normal normal = getFacetNormal(mesh, index);
+			n[0] = normal.x; n[1] = normal.y; n[2] = normal.z;
 		}
 	};
 
-	// Deduplicates the vertices to create a more common face-vertex data structure
-	FVMesh deduplicateVertices(const Mesh& inputMesh)
+	// Direct facet access for the templated writer functions
+	template<template<typename> class Allocator>
+	struct FacetAccess<BasicMesh<Allocator>>
 	{
-		FVMesh outputMesh;
-		auto addVertex = [&outputMesh](const Vertex& v)
+		static size_t getFacetCount(const BasicMesh<Allocator>& mesh) { return mesh.facets.size(); }
+
+		static void getFacet(const BasicMesh<Allocator>& mesh, size_t index, float v1[3], float v2[3], float v3[3], float n[3])
 		{
-			for (size_t i = 0; i < outputMesh.vertices.size(); i++)
-			{
-				if (v.x == outputMesh.vertices[i].x &&
-					v.y == outputMesh.vertices[i].y &&
-					v.z == outputMesh.vertices[i].z)
-				{
-					return i;
-				}
-			}
-			size_t index = outputMesh.vertices.size();
-			outputMesh.vertices.push_back(v);
-			return index;
-		};
+			const Facet& facet = mesh.facets[index];
+			memcpy(v1, &facet.v1, sizeof(Vertex));
+			memcpy(v2, &facet.v2, sizeof(Vertex));
+			memcpy(v3, &facet.v3, sizeof(Vertex));
+			Normal normal = getFacetNormal(mesh, index);
+			memcpy(n, &normal, sizeof(Normal));
+		}
+	};
+
+	template<template<typename> class Allocator>
+	struct FacetAccess<BasicFVMesh<Allocator>>
+	{
+		static size_t getFacetCount(const BasicFVMesh<Allocator>& mesh) { return mesh.facets.size(); }
+
+		static void getFacet(const BasicFVMesh<Allocator>& mesh, size_t index, float v1[3], float v2[3], float v3[3], float n[3])
+		{
+			const FVFacet& facet = mesh.facets[index];
+			const Vertex* vertices = mesh.vertices.data();
+			memcpy(v1, vertices + facet.v1, sizeof(Vertex));
+			memcpy(v2, vertices + facet.v2, sizeof(Vertex));
+			memcpy(v3, vertices + facet.v3, sizeof(Vertex));
+			Normal normal = getFacetNormal(mesh, index);
+			memcpy(n, &normal, sizeof(Normal));
+		}
+	};
+
+	// Deduplicates the vertices to create a more common face-vertex data structure
+	template<template<typename> class Allocator>
+	BasicFVMesh<Allocator> deduplicateVertices(const BasicMesh<Allocator>& inputMesh, const typename BasicFVMesh<Allocator>::allocator_type& allocator = {})
+	{
+		BasicFVMesh<Allocator> outputMesh(allocator);
+		BasicVertexIndexTable<Allocator> table(allocator);
+		outputMesh.facets.reserve(inputMesh.facets.size());
 		for (const auto& f : inputMesh.facets)
 		{
-			size_t i1 = addVertex(f.v1);
-			size_t i2 = addVertex(f.v2);
-			size_t i3 = addVertex(f.v3);
+			size_t i1 = table.insert(outputMesh.vertices, f.v1);
+			size_t i2 = table.insert(outputMesh.vertices, f.v2);
+			size_t i3 = table.insert(outputMesh.vertices, f.v3);
 			outputMesh.facets.push_back(FVFacet{i1, i2, i3, f.n});
 		}
+		outputMesh.pendingNormals.assign(inputMesh.pendingNormals.begin(), inputMesh.pendingNormals.end());
 		return outputMesh;
 	}
+
+	// Handler that deduplicates the vertices of meshes larger than the available memory.
+	// Vertices are collected in sorted runs that are spilled to temporary files when the memory budget is exceeded.
+	// After parsing, the runs are merged into the files vertices.bin (three floats per vertex), indices.bin
+	// (three uint32 vertex indices per facet) and normals.bin (three floats per facet) inside the work directory.
+	// The vertices are ordered by their coordinates, negative zero equals positive zero and NaN vertices are never merged.
+	struct ExternalDeduplicationHandler : Reader::Handler
+	{
+		// Results
+		std::filesystem::path vertexFile;
+		std::filesystem::path indexFile;
+		std::filesystem::path normalFile;
+		size_t vertexCount = 0;
+		size_t facetCount = 0;
+		std::string name;
+		std::vector<uint8_t> header;
+		bool ascii = false;
+		size_t errorLineNumber = 0;
+		microstl::Result result = microstl::Result::Undefined;
+
+		// Settings
+		bool forceNormals = false;
+		bool disableNormals = false;
+
+		ExternalDeduplicationHandler(const std::filesystem::path& workDirectory, size_t memoryBudget = 256u * 1024u * 1024u)
+			: directory(workDirectory), vertexRuns(workDirectory, "vertices", memoryBudget / 2), cornerRuns(workDirectory, "corners", memoryBudget / 2)
+		{
+			vertexFile = directory / "vertices.bin";
+			indexFile = directory / "indices.bin";
+			normalFile = directory / "normals.bin";
+		}
+
+		void onName(const std::string& n) override { name = n; }
+		void onBinaryHeader(const uint8_t buffer[80]) override { header.assign(buffer, buffer + 80); }
+		bool forceRecalculateNormals() override { return forceNormals; }
+		bool disableRecalculateNormals() override { return disableNormals; }
+		void onError(size_t l) override { errorLineNumber = l; }
+
+		void onBegin(bool m) override
+		{
+			vertexRuns.clear();
+			cornerRuns.clear();
+			vertexCount = facetCount = errorLineNumber = 0;
+			name.clear();
+			header.clear();
+			ascii = m;
+			result = microstl::Result::Undefined;
+			std::error_code error;
+			std::filesystem::create_directories(directory, error);
+			normals.open(normalFile, std::ios::binary | std::ios::trunc);
+			ok = normals.good();
+		}
+
+		void onFacet(const float v1[3], const float v2[3], const float v3[3], const float n[3]) override
+		{
+			uint64_t corner = facetCount * 3;
+			ok = ok && vertexRuns.add(VertexRecord{ { v1[0], v1[1], v1[2] }, corner });
+			ok = ok && vertexRuns.add(VertexRecord{ { v2[0], v2[1], v2[2] }, corner + 1 });
+			ok = ok && vertexRuns.add(VertexRecord{ { v3[0], v3[1], v3[2] }, corner + 2 });
+			normals.write(reinterpret_cast<const char*>(n), 3 * sizeof(float));
+			facetCount++;
+		}
+
+		void onEnd(Result r) override
+		{
+			normals.close();
+			ok = ok && !normals.fail();
+			if (r == Result::Success)
+				r = ok && merge() ? Result::Success : Result::FileError;
+			vertexRuns.clear();
+			cornerRuns.clear();
+			result = r;
+		}
+
+		// Load the result files into a face-vertex mesh, only useful when it fits into the memory
+		template<template<typename> class Allocator>
+		Result readFVMesh(BasicFVMesh<Allocator>& mesh) const
+		{
+			std::ifstream vs(vertexFile, std::ios::binary);
+			std::ifstream is(indexFile, std::ios::binary);
+			std::ifstream ns(normalFile, std::ios::binary);
+			if (!vs || !is || !ns)
+				return Result::FileError;
+			mesh.vertices.resize(vertexCount);
+			mesh.facets.resize(facetCount);
+			mesh.pendingNormals.clear();
+			vs.read(reinterpret_cast<char*>(mesh.vertices.data()), vertexCount * sizeof(Vertex));
+			for (auto& f : mesh.facets)
+			{
+				uint32_t indices[3];
+				is.read(reinterpret_cast<char*>(indices), sizeof(indices));
+				ns.read(reinterpret_cast<char*>(&f.n), sizeof(Normal));
+				f.v1 = indices[0];
+				f.v2 = indices[1];
+				f.v3 = indices[2];
+			}
+			return vs && is && ns ? Result::Success : Result::MissingDataError;
+		}
+
+	private:
+		struct VertexRecord { Vertex v; uint64_t corner; };
+		struct CornerRecord { uint64_t corner; uint64_t index; };
+
+		static uint32_t floatBits(float f)
+		{
+			// Adding zero turns negative zero into positive zero
+			f += 0.0f;
+			uint32_t bits;
+			memcpy(&bits, &f, sizeof(bits));
+			return bits;
+		}
+
+		struct VertexLess
+		{
+			bool operator()(const VertexRecord& a, const VertexRecord& b) const
+			{
+				uint32_t ka[3] = { floatBits(a.v.x), floatBits(a.v.y), floatBits(a.v.z) };
+				uint32_t kb[3] = { floatBits(b.v.x), floatBits(b.v.y), floatBits(b.v.z) };
+				return std::tie(ka[0], ka[1], ka[2], a.corner) < std::tie(kb[0], kb[1], kb[2], b.corner);
+			}
+		};
+
+		struct CornerLess
+		{
+			bool operator()(const CornerRecord& a, const CornerRecord& b) const { return a.corner < b.corner; }
+		};
+
+		// Sorts records that do not fit into the memory budget with sorted runs in temporary files
+		template <typename T, typename Less>
+		class ExternalSorter
+		{
+		public:
+			ExternalSorter(const std::filesystem::path& dir, const std::string& runPrefix, size_t memoryBudget)
+				: directory(dir), prefix(runPrefix), capacity(std::max<size_t>(1024, memoryBudget / sizeof(T))) {}
+			~ExternalSorter() { clear(); }
+
+			bool add(const T& record)
+			{
+				// Reserve the whole budget once, growing the vector could allocate about twice the budget
+				if (buffer.capacity() < capacity)
+					buffer.reserve(capacity);
+				buffer.push_back(record);
+				return buffer.size() < capacity || spill();
+			}
+
+			// Calls func(record) for all records in sorted order, func must return false to abort
+			template <typename Func>
+			bool merge(Func&& func)
+			{
+				if (runs.empty())
+				{
+					std::sort(buffer.begin(), buffer.end(), Less());
+					for (const auto& record : buffer)
+						if (!func(record))
+							return false;
+					return true;
+				}
+				if (!buffer.empty() && !spill())
+					return false;
+				buffer.clear();
+				buffer.shrink_to_fit();
+
+				// Merge groups of runs into longer runs first to limit the number of open files
+				while (runs.size() > MERGE_FAN_IN)
+				{
+					std::vector<std::filesystem::path> group(runs.begin(), runs.begin() + MERGE_FAN_IN);
+					runs.erase(runs.begin(), runs.begin() + MERGE_FAN_IN);
+					auto path = nextRunPath();
+					runs.push_back(path);
+					std::ofstream ofs(path, std::ios::binary | std::ios::trunc);
+					bool merged = ofs.is_open() && mergeRuns(group, [&](const T& record)
+					{
+						ofs.write(reinterpret_cast<const char*>(&record), sizeof(T));
+						return ofs.good();
+					});
+					ofs.close();
+					std::error_code error;
+					for (const auto& run : group)
+						std::filesystem::remove(run, error);
+					if (!merged || ofs.fail())
+						return false;
+				}
+
+				return mergeRuns(runs, func);
+			}
+
+			void clear()
+			{
+				std::error_code error;
+				for (const auto& run : runs)
+					std::filesystem::remove(run, error);
+				runs.clear();
+				buffer.clear();
+				runCounter = 0;
+			}
+
+			// Maximum number of runs that are merged at once
+			static inline const size_t MERGE_FAN_IN = 64;
+
+		private:
+			std::filesystem::path directory;
+			std::string prefix;
+			size_t capacity;
+			std::vector<T> buffer;
+			std::vector<std::filesystem::path> runs;
+			size_t runCounter = 0;
+
+			std::filesystem::path nextRunPath()
+			{
+				return directory / (prefix + "_run" + std::to_string(runCounter++) + ".tmp");
+			}
+
+			// Reads the next record of a run, returns false on errors and clears available at the end of the run
+			static bool readRecord(std::ifstream& stream, T& record, bool& available)
+			{
+				available = static_cast<bool>(stream.read(reinterpret_cast<char*>(&record), sizeof(T)));
+				return available || (stream.gcount() == 0 && stream.eof() && !stream.bad());
+			}
+
+			// K-way merge with a heap that holds the next record of each run
+			template <typename Func>
+			static bool mergeRuns(const std::vector<std::filesystem::path>& paths, Func&& func)
+			{
+				std::vector<std::ifstream> streams;
+				streams.reserve(paths.size());
+				using Entry = std::pair<T, size_t>;
+				auto greater = [](const Entry& a, const Entry& b) { return Less()(b.first, a.first); };
+				std::vector<Entry> heap;
+				for (size_t i = 0; i < paths.size(); i++)
+				{
+					streams.emplace_back(paths[i], std::ios::binary);
+					T record;
+					bool available = false;
+					if (!streams[i].is_open() || !readRecord(streams[i], record, available))
+						return false;
+					if (available)
+						heap.emplace_back(record, i);
+				}
+				std::make_heap(heap.begin(), heap.end(), greater);
+				while (!heap.empty())
+				{
+					std::pop_heap(heap.begin(), heap.end(), greater);
+					Entry& entry = heap.back();
+					if (!func(entry.first))
+						return false;
+					bool available = false;
+					if (!readRecord(streams[entry.second], entry.first, available))
+						return false;
+					if (available)
+						std::push_heap(heap.begin(), heap.end(), greater);
+					else
+						heap.pop_back();
+				}
+				return true;
+			}
+
+			bool spill()
+			{
+				std::sort(buffer.begin(), buffer.end(), Less());
+				auto path = nextRunPath();
+				std::ofstream ofs(path, std::ios::binary | std::ios::trunc);
+				runs.push_back(path);
+				ofs.write(reinterpret_cast<const char*>(buffer.data()), buffer.size() * sizeof(T));
+				buffer.clear();
+				ofs.close();
+				return !ofs.fail();
+			}
+		};
+
+		std::filesystem::path directory;
+		ExternalSorter<VertexRecord, VertexLess> vertexRuns;
+		ExternalSorter<CornerRecord, CornerLess> cornerRuns;
+		std::ofstream normals;
+		bool ok = false;
+
+		bool merge()
+		{
+			// Equal vertices are neighbors in the sorted order and get the same index
+			std::ofstream vertices(vertexFile, std::ios::binary | std::ios::trunc);
+			if (!vertices)
+				return false;
+			bool first = true;
+			uint32_t last[3] = { 0, 0, 0 };
+			bool merged = vertexRuns.merge([&](const VertexRecord& record)
+			{
+				uint32_t key[3] = { floatBits(record.v.x), floatBits(record.v.y), floatBits(record.v.z) };
+				bool isNaN = record.v.x != record.v.x || record.v.y != record.v.y || record.v.z != record.v.z;
+				if (first || isNaN || memcmp(key, last, sizeof(key)) != 0)
+				{
+					if (vertexCount >= std::numeric_limits<uint32_t>::max())
+						return false;
+					vertices.write(reinterpret_cast<const char*>(&record.v), sizeof(Vertex));
+					memcpy(last, key, sizeof(key));
+					vertexCount++;
+					first = false;
+				}
+				return cornerRuns.add(CornerRecord{ record.corner, vertexCount - 1 });
+			});
+			vertices.close();
+			if (!merged || vertices.fail())
+				return false;
+
+			// Sorting by the corners again restores the order of the facets
+			std::ofstream indices(indexFile, std::ios::binary | std::ios::trunc);
+			if (!indices)
+				return false;
+			merged = cornerRuns.merge([&](const CornerRecord& record)
+			{
+				uint32_t index = static_cast<uint32_t>(record.index);
+				indices.write(reinterpret_cast<const char*>(&index), sizeof(index));
+				return indices.good();
+			});
+			indices.close();
+			return merged && !indices.fail();
+		}
+	};
+
+	// Adjacency from the vertices to their facets in compressed rows.
+	// The facets of vertex v are stored in ascending order from facets[offsets[v]] to facets[offsets[v + 1] - 1].
+	struct VertexFacetAdjacency
+	{
+		std::vector<size_t> offsets;
+		std::vector<size_t> facets;
+	};
+
+	template<template<typename> class Allocator>
+	VertexFacetAdjacency computeVertexFacetAdjacency(const BasicFVMesh<Allocator>& mesh)
+	{
+		VertexFacetAdjacency adjacency;
+		adjacency.offsets.assign(mesh.vertices.size() + 1, 0);
+		for (const auto& f : mesh.facets)
+		{
+			adjacency.offsets[f.v1 + 1]++;
+			adjacency.offsets[f.v2 + 1]++;
+			adjacency.offsets[f.v3 + 1]++;
+		}
+		std::partial_sum(adjacency.offsets.begin(), adjacency.offsets.end(), adjacency.offsets.begin());
+		adjacency.facets.resize(adjacency.offsets.back());
+		std::vector<size_t> fill(adjacency.offsets.begin(), adjacency.offsets.end() - 1);
+		for (size_t t = 0; t < mesh.facets.size(); t++)
+		{
+			const auto& f = mesh.facets[t];
+			adjacency.facets[fill[f.v1]++] = t;
+			adjacency.facets[fill[f.v2]++] = t;
+			adjacency.facets[fill[f.v3]++] = t;
+		}
+		return adjacency;
+	}
+
+	// Statistics of a simulated FIFO vertex cache for the facet order of a mesh
+	struct VertexCacheStatistics
+	{
+		size_t transformedVertices = 0;
+		double acmr = 0; // Average cache miss ratio, transformed vertices per facet (0.5 is optimal for large closed meshes)
+		double atvr = 0; // Average transformed vertex ratio, transformed vertices per referenced vertex (1.0 is optimal)
+	};
+
+	// Simulate a FIFO vertex cache of the given size to measure the index locality of a mesh
+	template<template<typename> class Allocator>
+	VertexCacheStatistics analyzeVertexCache(const BasicFVMesh<Allocator>& mesh, size_t cacheSize = 16)
+	{
+		VertexCacheStatistics stats;
+		if (mesh.facets.empty() || cacheSize == 0)
+			return stats;
+
+		// A vertex is inside the cache when less than cacheSize misses happened since it was loaded
+		const size_t notLoaded = std::numeric_limits<size_t>::max();
+		std::vector<size_t> loadTime(mesh.vertices.size(), notLoaded);
+		size_t referencedVertices = 0;
+		for (const auto& f : mesh.facets)
+		{
+			for (size_t v : { f.v1, f.v2, f.v3 })
+			{
+				if (loadTime[v] == notLoaded)
+					referencedVertices++;
+				else if (stats.transformedVertices - loadTime[v] < cacheSize)
+					continue;
+				loadTime[v] = stats.transformedVertices++;
+			}
+		}
+
+		stats.acmr = static_cast<double>(stats.transformedVertices) / mesh.facets.size();
+		stats.atvr = static_cast<double>(stats.transformedVertices) / referencedVertices;
+		return stats;
+	}
+
+	// Reorder the facets for a better vertex cache locality using the Tipsify algorithm
+	// from "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw" (Sander et al. 2007).
+	template<template<typename> class Allocator>
+	void optimizeVertexCache(BasicFVMesh<Allocator>& mesh, size_t cacheSize = 16)
+	{
+		fixNormals(mesh);
+		const size_t vertexCount = mesh.vertices.size();
+		const size_t facetCount = mesh.facets.size();
+		if (facetCount == 0)
+			return;
+
+		auto vertexFacets = computeVertexFacetAdjacency(mesh);
+		const auto& offsets = vertexFacets.offsets;
+		const auto& adjacency = vertexFacets.facets;
+		std::vector<size_t> live(vertexCount);
+		for (size_t v = 0; v < vertexCount; v++)
+			live[v] = offsets[v + 1] - offsets[v];
+
+		std::vector<size_t> cacheTime(vertexCount, 0);
+		std::vector<bool> emitted(facetCount, false);
+		std::vector<size_t> deadEnd;
+		std::vector<size_t> candidates;
+		std::vector<size_t> order;
+		order.reserve(facetCount);
+		size_t time = cacheSize + 1;
+		size_t cursor = 0;
+		const size_t none = std::numeric_limits<size_t>::max();
+
+		// Find the next vertex with remaining facets, first from the dead end stack and then in input order
+		auto skipDeadEnd = [&]()
+		{
+			while (!deadEnd.empty())
+			{
+				size_t v = deadEnd.back();
+				deadEnd.pop_back();
+				if (live[v] > 0)
+					return v;
+			}
+			while (cursor < vertexCount)
+			{
+				if (live[cursor] > 0)
+					return cursor;
+				cursor++;
+			}
+			return none;
+		};
+
+		size_t fanning = skipDeadEnd();
+		while (fanning != none)
+		{
+			candidates.clear();
+			for (size_t i = offsets[fanning]; i < offsets[fanning + 1]; i++)
+			{
+				size_t t = adjacency[i];
+				if (emitted[t])
+					continue;
+				emitted[t] = true;
+				order.push_back(t);
+				const auto& f = mesh.facets[t];
+				for (size_t v : { f.v1, f.v2, f.v3 })
+				{
+					deadEnd.push_back(v);
+					candidates.push_back(v);
+					live[v]--;
+					if (time - cacheTime[v] > cacheSize)
+						cacheTime[v] = time++;
+				}
+			}
+
+			// Prefer the candidate that stays longest in the cache while its remaining facets are emitted
+			size_t best = none;
+			size_t bestPriority = 0;
+			for (size_t v : candidates)
+			{
+				if (live[v] == 0)
+					continue;
+				size_t priority = 0;
+				if (time - cacheTime[v] + 2 * live[v] <= cacheSize)
+					priority = time - cacheTime[v];
+				if (best == none || priority > bestPriority)
+				{
+					best = v;
+					bestPriority = priority;
+				}
+			}
+			fanning = best != none ? best : skipDeadEnd();
+		}
+
+		decltype(mesh.facets) facets(mesh.facets.get_allocator());
+		facets.reserve(facetCount);
+		for (size_t t : order)
+			facets.push_back(mesh.facets[t]);
+		mesh.facets.swap(facets);
+	}
+
+	// Reorder the vertices in the order of their first use by the facets and remap the indices accordingly.
+	// This improves the memory locality of vertex fetches, unused vertices are moved to the end.
+	template<template<typename> class Allocator>
+	void optimizeVertexFetch(BasicFVMesh<Allocator>& mesh)
+	{
+		const size_t none = std::numeric_limits<size_t>::max();
+		std::vector<size_t> remap(mesh.vertices.size(), none);
+		size_t next = 0;
+		for (auto& f : mesh.facets)
+		{
+			for (size_t* v : { &f.v1, &f.v2, &f.v3 })
+			{
+				if (remap[*v] == none)
+					remap[*v] = next++;
+				*v = remap[*v];
+			}
+		}
+
+		decltype(mesh.vertices) vertices(mesh.vertices.size(), mesh.vertices.get_allocator());
+		for (size_t v = 0; v < mesh.vertices.size(); v++)
+		{
+			if (remap[v] == none)
+				remap[v] = next++;
+			vertices[remap[v]] = mesh.vertices[v];
+		}
+		mesh.vertices.swap(vertices);
+	}
+
+	// Small cluster of facets with local vertex indices, for example for mesh shaders or culling
+	struct Meshlet
+	{
+		size_t vertexOffset = 0; // First entry in Meshlets::vertices
+		size_t vertexCount = 0;
+		size_t facetOffset = 0; // First facet, its local indices start at Meshlets::indices[3 * facetOffset]
+		size_t facetCount = 0;
+	};
+	struct Meshlets
+	{
+		std::vector<Meshlet> meshlets;
+		std::vector<size_t> vertices; // Mesh vertex indices referenced by the meshlets
+		std::vector<uint8_t> indices; // Three local vertex indices per facet
+	};
+
+	// Partition the facets in their current order into meshlets with limited vertex and facet counts.
+	// Run optimizeVertexCache() before to get meshlets with well connected facets.
+	template<template<typename> class Allocator>
+	Meshlets buildMeshlets(const BasicFVMesh<Allocator>& mesh, size_t maxVertices = 64, size_t maxFacets = 124)
+	{
+		if (maxVertices < 3 || maxVertices > 256 || maxFacets == 0)
+			throw std::runtime_error("Invalid meshlet limits");
+
+		Meshlets result;
+		result.indices.reserve(mesh.facets.size() * 3);
+		const size_t none = std::numeric_limits<size_t>::max();
+		std::vector<size_t> localIndex(mesh.vertices.size(), none);
+		Meshlet current;
+
+		auto finish = [&]()
+		{
+			for (size_t i = current.vertexOffset; i < result.vertices.size(); i++)
+				localIndex[result.vertices[i]] = none;
+			result.meshlets.push_back(current);
+			current = Meshlet{ result.vertices.size(), 0, current.facetOffset + current.facetCount, 0 };
+		};
+
+		for (const auto& f : mesh.facets)
+		{
+			// Degenerated facets can reference the same vertex multiple times
+			size_t newVertices = 0;
+			if (localIndex[f.v1] == none)
+				newVertices++;
+			if (localIndex[f.v2] == none && f.v2 != f.v1)
+				newVertices++;
+			if (localIndex[f.v3] == none && f.v3 != f.v1 && f.v3 != f.v2)
+				newVertices++;
+			if (current.vertexCount + newVertices > maxVertices || current.facetCount + 1 > maxFacets)
+				finish();
+
+			for (size_t v : { f.v1, f.v2, f.v3 })
+			{
+				if (localIndex[v] == none)
+				{
+					localIndex[v] = current.vertexCount++;
+					result.vertices.push_back(v);
+				}
+				result.indices.push_back(static_cast<uint8_t>(localIndex[v]));
+			}
+			current.facetCount++;
+		}
+		if (current.facetCount > 0)
+			finish();
+
+		return result;
+	}
+
+	// Settings for the quantization of meshes
+	struct QuantizationSettings
+	{
+		// Bits per axis for the vertex positions relative to the bounding box, either 16 or 21
+		uint32_t bits = 16;
+
+		// Optional upper bound for the position error, more bits are used when needed.
+		// Zero disables the check, an exception is thrown when even 21 bits are not enough.
+		float maxError = 0.0f;
+	};
+
+	// Compact face-vertex mesh with quantized positions, octahedron encoded normals and compressed indices
+	struct QuantizedMesh
+	{
+		// The position of a vertex is boundsMin + q * scale for its quantized coordinates q
+		Vertex boundsMin{ 0, 0, 0 };
+		Vertex scale{ 0, 0, 0 };
+		uint32_t bits = 16;
+		size_t vertexCount = 0;
+		size_t facetCount = 0;
+
+		std::pmr::vector<uint16_t> positions16; // Three values per vertex when using 16 bits
+		std::pmr::vector<uint64_t> positions21; // One value per vertex when using 21 bits, packed as x | y << 21 | z << 42
+		std::pmr::vector<uint32_t> normals; // One octahedron encoded normal with two 16 bit values per facet
+		std::pmr::vector<uint8_t> indices; // Differences to the previous index as zigzag and varint encoded bytes
+
+		QuantizedMesh() {}
+		explicit QuantizedMesh(std::pmr::memory_resource* resource) : positions16(resource), positions21(resource), normals(resource), indices(resource) {}
+
+		// Largest possible distance of a decoded coordinate to the original coordinate on any axis.
+		// Includes the rounding to the grid and the float precision of the decoded coordinates.
+		float getMaxError() const
+		{
+			float steps = static_cast<float>((1u << bits) - 1u);
+			auto axisError = [steps](float origin, float step)
+			{
+				float extent = std::max(std::abs(origin), std::abs(origin + step * steps));
+				return step * 0.5f + extent * 2.0f * std::numeric_limits<float>::epsilon();
+			};
+			return std::max({ axisError(boundsMin.x, scale.x), axisError(boundsMin.y, scale.y), axisError(boundsMin.z, scale.z) });
+		}
+
+		// Size of all encoded data in bytes
+		size_t getMemorySize() const
+		{
+			return positions16.size() * sizeof(uint16_t) + positions21.size() * sizeof(uint64_t) +
+				normals.size() * sizeof(uint32_t) + indices.size();
+		}
+
+		// Octahedron encoding of unit normal vectors, zero vectors are encoded with an otherwise unused value
+		static uint32_t encodeNormal(const Normal& n)
+		{
+			float length = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+			if (!(length > 0.0f) || !std::isfinite(length))
+				return 0x80008000u;
+			float x = n.x / length;
+			float y = n.y / length;
+			if (n.z < 0.0f)
+			{
+				float foldedX = (1.0f - std::abs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+				float foldedY = (1.0f - std::abs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+				x = foldedX;
+				y = foldedY;
+			}
+			auto toSnorm = [](float v) { return static_cast<uint16_t>(static_cast<int16_t>(std::lround(std::clamp(v, -1.0f, 1.0f) * 32767.0f))); };
+			return toSnorm(x) | (static_cast<uint32_t>(toSnorm(y)) << 16);
+		}
+
+		static Normal decodeNormal(uint32_t value)
+		{
+			if (value == 0x80008000u)
+				return Normal{ 0, 0, 0 };
+			float x = static_cast<int16_t>(value & 0xFFFFu) / 32767.0f;
+			float y = static_cast<int16_t>(value >> 16) / 32767.0f;
+			float z = 1.0f - std::abs(x) - std::abs(y);
+			if (z < 0.0f)
+			{
+				float unfoldedX = (1.0f - std::abs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+				float unfoldedY = (1.0f - std::abs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+				x = unfoldedX;
+				y = unfoldedY;
+			}
+			float length = std::sqrt(x * x + y * y + z * z);
+			return Normal{ x / length, y / length, z / length };
+		}
+	};
+
+	// Quantize a face-vertex mesh into the compact representation
+	template<template<typename> class Allocator>
+	QuantizedMesh quantizeMesh(const BasicFVMesh<Allocator>& mesh, const QuantizationSettings& settings = QuantizationSettings(),
+		std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+	{
+		if (settings.bits != 16 && settings.bits != 21)
+			throw std::runtime_error("Only 16 or 21 bits are supported for the quantization");
+
+		QuantizedMesh result(resource);
+		result.vertexCount = mesh.vertices.size();
+		result.facetCount = mesh.facets.size();
+
+		// Bounding box of all finite coordinates
+		float minimum[3] = { INFINITY, INFINITY, INFINITY };
+		float maximum[3] = { -INFINITY, -INFINITY, -INFINITY };
+		for (const auto& v : mesh.vertices)
+		{
+			const float c[3] = { v.x, v.y, v.z };
+			for (int axis = 0; axis < 3; axis++)
+			{
+				if (std::isfinite(c[axis]))
+				{
+					minimum[axis] = std::min(minimum[axis], c[axis]);
+					maximum[axis] = std::max(maximum[axis], c[axis]);
+				}
+			}
+		}
+		for (int axis = 0; axis < 3; axis++)
+		{
+			if (minimum[axis] > maximum[axis])
+				minimum[axis] = maximum[axis] = 0.0f;
+		}
+
+		// Use more bits when the error bound would be exceeded
+		auto computeScale = [&](uint32_t bits)
+		{
+			float steps = static_cast<float>((1u << bits) - 1u);
+			return Vertex{ (maximum[0] - minimum[0]) / steps, (maximum[1] - minimum[1]) / steps, (maximum[2] - minimum[2]) / steps };
+		};
+		result.bits = settings.bits;
+		result.boundsMin = Vertex{ minimum[0], minimum[1], minimum[2] };
+		result.scale = computeScale(result.bits);
+		if (settings.maxError > 0.0f && result.getMaxError() > settings.maxError)
+		{
+			result.bits = 21;
+			result.scale = computeScale(result.bits);
+			if (result.getMaxError() > settings.maxError)
+				throw std::runtime_error("Quantization error bound cannot be reached with 21 bits");
+		}
+
+		// Positions
+		const uint32_t maxValue = (1u << result.bits) - 1u;
+		const double inverse[3] = {
+			result.scale.x > 0.0f ? 1.0 / result.scale.x : 0.0,
+			result.scale.y > 0.0f ? 1.0 / result.scale.y : 0.0,
+			result.scale.z > 0.0f ? 1.0 / result.scale.z : 0.0
+		};
+		auto quantize = [&](float value, int axis)
+		{
+			// Double precision keeps the rounding to the grid exact enough for 21 bits
+			double q = (static_cast<double>(value) - minimum[axis]) * inverse[axis] + 0.5;
+			if (!(q > 0.0))
+				return 0u;
+			return static_cast<uint32_t>(std::min(q, static_cast<double>(maxValue)));
+		};
+		if (result.bits == 16)
+		{
+			result.positions16.resize(mesh.vertices.size() * 3);
+			for (size_t i = 0; i < mesh.vertices.size(); i++)
+			{
+				const Vertex& v = mesh.vertices[i];
+				result.positions16[3 * i + 0] = static_cast<uint16_t>(quantize(v.x, 0));
+				result.positions16[3 * i + 1] = static_cast<uint16_t>(quantize(v.y, 1));
+				result.positions16[3 * i + 2] = static_cast<uint16_t>(quantize(v.z, 2));
+			}
+		}
+		else
+		{
+			result.positions21.resize(mesh.vertices.size());
+			for (size_t i = 0; i < mesh.vertices.size(); i++)
+			{
+				const Vertex& v = mesh.vertices[i];
+				result.positions21[i] = static_cast<uint64_t>(quantize(v.x, 0)) |
+					(static_cast<uint64_t>(quantize(v.y, 1)) << 21) | (static_cast<uint64_t>(quantize(v.z, 2)) << 42);
+			}
+		}
+
+		// Normals and indices
+		result.normals.resize(mesh.facets.size());
+		result.indices.reserve(mesh.facets.size() * 4);
+		uint64_t previous = 0;
+		for (size_t t = 0; t < mesh.facets.size(); t++)
+		{
+			const FVFacet& f = mesh.facets[t];
+			result.normals[t] = QuantizedMesh::encodeNormal(getFacetNormal(mesh, t));
+			for (size_t index : { f.v1, f.v2, f.v3 })
+			{
+				int64_t delta = static_cast<int64_t>(index - previous);
+				uint64_t value = (static_cast<uint64_t>(delta) << 1) ^ static_cast<uint64_t>(delta >> 63);
+				while (value >= 0x80u)
+				{
+					result.indices.push_back(static_cast<uint8_t>(value | 0x80u));
+					value >>= 7;
+				}
+				result.indices.push_back(static_cast<uint8_t>(value));
+				previous = index;
+			}
+		}
+		result.indices.shrink_to_fit();
+
+		return result;
+	}
+
+	// Quantize a mesh into the compact representation, the vertices are deduplicated first
+	template<template<typename> class Allocator>
+	QuantizedMesh quantizeMesh(const BasicMesh<Allocator>& mesh, const QuantizationSettings& settings = QuantizationSettings(),
+		std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+	{
+		return quantizeMesh(deduplicateVertices(mesh), settings, resource);
+	}
+
+	// Decode the compact representation into a face-vertex mesh again
+	template<template<typename> class Allocator = std::allocator>
+	BasicFVMesh<Allocator> dequantizeMesh(const QuantizedMesh& mesh, const typename BasicFVMesh<Allocator>::allocator_type& allocator = {})
+	{
+		// The counts must match the data, so the decoding never reads outside of the vectors
+		if (mesh.bits != 16 && mesh.bits != 21)
+			throw std::runtime_error("Invalid bit count in quantized mesh");
+		bool positionsValid = mesh.bits == 16
+			? mesh.positions16.size() % 3 == 0 && mesh.positions16.size() / 3 == mesh.vertexCount
+			: mesh.positions21.size() == mesh.vertexCount;
+		if (!positionsValid || mesh.normals.size() != mesh.facetCount)
+			throw std::runtime_error("Invalid size in quantized mesh");
+
+		BasicFVMesh<Allocator> result(allocator);
+		result.vertices.resize(mesh.vertexCount);
+		const Vertex& o = mesh.boundsMin;
+		const Vertex& s = mesh.scale;
+		if (mesh.bits == 16)
+		{
+			const uint16_t* q = mesh.positions16.data();
+			for (size_t i = 0; i < mesh.vertexCount; i++)
+				result.vertices[i] = Vertex{ o.x + q[3 * i] * s.x, o.y + q[3 * i + 1] * s.y, o.z + q[3 * i + 2] * s.z };
+		}
+		else
+		{
+			const uint64_t* q = mesh.positions21.data();
+			const uint64_t mask = (1u << 21) - 1u;
+			for (size_t i = 0; i < mesh.vertexCount; i++)
+			{
+				result.vertices[i] = Vertex{
+					o.x + static_cast<float>(q[i] & mask) * s.x,
+					o.y + static_cast<float>((q[i] >> 21) & mask) * s.y,
+					o.z + static_cast<float>((q[i] >> 42) & mask) * s.z };
+			}
+		}
+
+		result.facets.resize(mesh.facetCount);
+		const uint8_t* data = mesh.indices.data();
+		const uint8_t* end = data + mesh.indices.size();
+		uint64_t previous = 0;
+		auto nextIndex = [&]()
+		{
+			uint64_t value = 0;
+			for (int shift = 0; data < end && shift < 64; shift += 7)
+			{
+				uint8_t byte = *data++;
+				value |= static_cast<uint64_t>(byte & 0x7Fu) << shift;
+				if (byte < 0x80u)
+					break;
+			}
+			previous += (value >> 1) ^ (0 - (value & 1));
+			if (previous >= mesh.vertexCount)
+				throw std::runtime_error("Invalid index in quantized mesh");
+			return static_cast<size_t>(previous);
+		};
+		for (size_t t = 0; t < mesh.facetCount; t++)
+		{
+			FVFacet& f = result.facets[t];
+			f.v1 = nextIndex();
+			f.v2 = nextIndex();
+			f.v3 = nextIndex();
+			f.n = QuantizedMesh::decodeNormal(mesh.normals[t]);
+		}
+
+		return result;
+	}
+
+	// Runs func(begin, end) on multiple threads for disjoint chunks of the index range [0, count).
+	// A thread count of zero will use all available hardware threads.
+	template <typename Func>
+	void parallelFor(size_t count, size_t threadCount, Func&& func)
+	{
+		if (count == 0)
+			return;
+		if (threadCount == 0)
+			threadCount = std::max<size_t>(1, std::thread::hardware_concurrency());
+		threadCount = std::min(threadCount, count);
+		if (threadCount == 1)
+			return func(size_t(0), count);
+
+		// Hand out small chunks so that threads finishing early can pick up more work
+		const size_t chunkSize = std::max<size_t>(1, count / (threadCount * 8));
+		std::atomic<size_t> next(0);
+		auto worker = [&]()
+		{
+			while (true)
+			{
+				size_t begin = next.fetch_add(chunkSize);
+				if (begin >= count)
+					break;
+				func(begin, std::min(begin + chunkSize, count));
+			}
+		};
+		std::vector<std::thread> threads;
+		for (size_t t = 1; t < threadCount; t++)
+			threads.emplace_back(worker);
+		worker();
+		for (auto& thread : threads)
+			thread.join();
+	}
+
+	// Sorts a vector on multiple threads by sorting chunks in parallel and merging them pairwise afterwards.
+	// A thread count of zero will use all available hardware threads.
+	template <typename T, typename Compare>
+	void parallelSort(std::vector<T>& data, size_t threadCount, Compare compare)
+	{
+		if (threadCount == 0)
+			threadCount = std::max<size_t>(1, std::thread::hardware_concurrency());
+		const size_t chunkCount = std::min(threadCount, std::max<size_t>(1, data.size() / 4096));
+		if (chunkCount <= 1)
+			return std::sort(data.begin(), data.end(), compare);
+
+		std::vector<size_t> bounds(chunkCount + 1);
+		for (size_t c = 0; c <= chunkCount; c++)
+			bounds[c] = data.size() * c / chunkCount;
+		parallelFor(chunkCount, threadCount, [&](size_t begin, size_t end)
+		{
+			for (size_t c = begin; c < end; c++)
+				std::sort(data.begin() + bounds[c], data.begin() + bounds[c + 1], compare);
+		});
+		for (size_t width = 1; width < chunkCount; width *= 2)
+		{
+			size_t mergeCount = (chunkCount + 2 * width - 1) / (2 * width);
+			parallelFor(mergeCount, threadCount, [&](size_t begin, size_t end)
+			{
+				for (size_t m = begin; m < end; m++)
+				{
+					size_t first = bounds[m * 2 * width];
+					size_t middle = bounds[std::min(m * 2 * width + width, chunkCount)];
+					size_t last = bounds[std::min(m * 2 * width + 2 * width, chunkCount)];
+					std::inplace_merge(data.begin() + first, data.begin() + middle, data.begin() + last, compare);
+				}
+			});
+		}
+	}
+
+	// Weighting of the facet normals for the vertex normals
+	enum class NormalWeighting
+	{
+		Uniform, // All facets contribute equally
+		Area, // Facets contribute proportional to their area
+		Angle // Facets contribute proportional to their interior angle at the vertex
+	};
+
+	// Compute smooth vertex normals from the geometry of the facets on multiple threads.
+	// The returned normals have the same indices as the vertices, vertices without facets get a zero normal.
+	// Each vertex gathers its facets in a fixed order, so the results do not depend on the thread count.
+	template<template<typename> class Allocator>
+	std::pmr::vector<Normal> computeVertexNormals(const BasicFVMesh<Allocator>& mesh, NormalWeighting weighting = NormalWeighting::Angle,
+		size_t threadCount = 0, std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+	{
+		// Unnormalized facet normals, their length is twice the facet area
+		std::vector<Normal> facetNormals(mesh.facets.size());
+		parallelFor(mesh.facets.size(), threadCount, [&](size_t begin, size_t end)
+		{
+			for (size_t t = begin; t < end; t++)
+			{
+				const auto& f = mesh.facets[t];
+				const Vertex& a = mesh.vertices[f.v1];
+				const Vertex& b = mesh.vertices[f.v2];
+				const Vertex& c = mesh.vertices[f.v3];
+				float e1[3] = { b.x - a.x, b.y - a.y, b.z - a.z };
+				float e2[3] = { c.x - a.x, c.y - a.y, c.z - a.z };
+				facetNormals[t] = Normal{ e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+			}
+		});
+
+		auto adjacency = computeVertexFacetAdjacency(mesh);
+		std::pmr::vector<Normal> normals(mesh.vertices.size(), Normal{ 0, 0, 0 }, resource);
+		parallelFor(mesh.vertices.size(), threadCount, [&](size_t begin, size_t end)
+		{
+			for (size_t v = begin; v < end; v++)
+			{
+				float sum[3] = { 0, 0, 0 };
+				for (size_t i = adjacency.offsets[v]; i < adjacency.offsets[v + 1]; i++)
+				{
+					size_t t = adjacency.facets[i];
+					const Normal& n = facetNormals[t];
+					float length = std::sqrt(n.x * n.x + n.y * n.y + n.z * n.z);
+					if (!(length > 0.0f))
+						continue;
+
+					float weight = 1.0f / length;
+					if (weighting == NormalWeighting::Area)
+					{
+						weight = 1.0f;
+					}
+					else if (weighting == NormalWeighting::Angle)
+					{
+						// Interior angle between the two edges of the facet at this vertex
+						const auto& f = mesh.facets[t];
+						size_t other1 = f.v1 == v ? f.v2 : f.v1;
+						size_t other2 = f.v3 == v ? f.v2 : f.v3;
+						const Vertex& p = mesh.vertices[v];
+						const Vertex& q = mesh.vertices[other1];
+						const Vertex& r = mesh.vertices[other2];
+						float d1[3] = { q.x - p.x, q.y - p.y, q.z - p.z };
+						float d2[3] = { r.x - p.x, r.y - p.y, r.z - p.z };
+						float l1 = std::sqrt(d1[0] * d1[0] + d1[1] * d1[1] + d1[2] * d1[2]);
+						float l2 = std::sqrt(d2[0] * d2[0] + d2[1] * d2[1] + d2[2] * d2[2]);
+						if (!(l1 > 0.0f && l2 > 0.0f))
+							continue;
+						float cosine = (d1[0] * d2[0] + d1[1] * d2[1] + d1[2] * d2[2]) / (l1 * l2);
+						weight *= std::acos(std::clamp(cosine, -1.0f, 1.0f));
+					}
+					sum[0] += n.x * weight;
+					sum[1] += n.y * weight;
+					sum[2] += n.z * weight;
+				}
+
+				float length = std::sqrt(sum[0] * sum[0] + sum[1] * sum[1] + sum[2] * sum[2]);
+				if (length > 0.0f)
+					normals[v] = Normal{ sum[0] / length, sum[1] / length, sum[2] / length };
+			}
+		});
+
+		return normals;
+	}
+
+	// Edges of a face-vertex mesh with their adjacent facets in compressed rows, built with a parallel sort of the edge keys.
+	// Edges of degenerated facets that connect a vertex with itself are ignored.
+	class EdgeAdjacency
+	{
+	public:
+		// Vertex indices of an edge, always with v1 < v2
+		struct Edge { size_t v1; size_t v2; };
+
+		EdgeAdjacency() {}
+
+		template<template<typename> class Allocator>
+		explicit EdgeAdjacency(const BasicFVMesh<Allocator>& mesh, size_t threadCount = 0)
+		{
+			if (mesh.vertices.size() > std::numeric_limits<uint32_t>::max())
+				throw std::runtime_error("Too many vertices for the edge adjacency");
+
+			// One entry per facet side with the sorted vertex indices packed into a single key
+			struct Entry { uint64_t key; size_t facet; };
+			std::vector<Entry> entries(mesh.facets.size() * 3);
+			parallelFor(mesh.facets.size(), threadCount, [&](size_t begin, size_t end)
+			{
+				for (size_t t = begin; t < end; t++)
+				{
+					const FVFacet& f = mesh.facets[t];
+					const size_t corners[4] = { f.v1, f.v2, f.v3, f.v1 };
+					for (size_t i = 0; i < 3; i++)
+					{
+						uint64_t a = std::min(corners[i], corners[i + 1]);
+						uint64_t b = std::max(corners[i], corners[i + 1]);
+						entries[3 * t + i] = Entry{ a == b ? std::numeric_limits<uint64_t>::max() : (a << 32) | b, t };
+					}
+				}
+			});
+			parallelSort(entries, threadCount, [](const Entry& a, const Entry& b)
+			{
+				return a.key < b.key || (a.key == b.key && a.facet < b.facet);
+			});
+
+			facets.reserve(entries.size());
+			offsets.push_back(0);
+			for (size_t i = 0; i < entries.size() && entries[i].key != std::numeric_limits<uint64_t>::max(); i++)
+			{
+				// Degenerated facets can contain the same edge twice
+				if (i > 0 && entries[i].key == entries[i - 1].key && entries[i].facet == entries[i - 1].facet)
+					continue;
+				if (i == 0 || entries[i].key != entries[i - 1].key)
+				{
+					if (i > 0)
+						offsets.push_back(facets.size());
+					edges.push_back(Edge{ static_cast<size_t>(entries[i].key >> 32), static_cast<size_t>(entries[i].key & 0xFFFFFFFFu) });
+				}
+				facets.push_back(entries[i].facet);
+			}
+			if (!edges.empty())
+				offsets.push_back(facets.size());
+
+			// Only vertices that are referenced by facets count for the Euler characteristic
+			std::vector<bool> used(mesh.vertices.size(), false);
+			for (const auto& f : mesh.facets)
+				used[f.v1] = used[f.v2] = used[f.v3] = true;
+			vertexCount = std::count(used.begin(), used.end(), true);
+			facetCount = mesh.facets.size();
+		}
+
+		size_t getEdgeCount() const { return edges.size(); }
+		const Edge& getEdge(size_t edge) const { return edges[edge]; }
+
+		// Number of facets that share an edge and their indices
+		size_t getFacetCount(size_t edge) const { return offsets[edge + 1] - offsets[edge]; }
+		const size_t* getFacets(size_t edge) const { return facets.data() + offsets[edge]; }
+
+		// Open edges with only one facet
+		std::vector<size_t> getBoundaryEdges() const { return findEdges([](size_t count) { return count == 1; }); }
+
+		// Edges shared by more than two facets
+		std::vector<size_t> getNonManifoldEdges() const { return findEdges([](size_t count) { return count > 2; }); }
+
+		// A closed manifold mesh has exactly two facets at every edge
+		bool isWatertight() const
+		{
+			if (edges.empty())
+				return false;
+			for (size_t e = 0; e < edges.size(); e++)
+				if (getFacetCount(e) != 2)
+					return false;
+			return true;
+		}
+
+		// V - E + F for the used vertices, which is 2 for a closed mesh without holes like a sphere
+		int64_t getEulerCharacteristic() const
+		{
+			return static_cast<int64_t>(vertexCount) - static_cast<int64_t>(edges.size()) + static_cast<int64_t>(facetCount);
+		}
+
+	private:
+		std::vector<Edge> edges;
+		std::vector<size_t> offsets;
+		std::vector<size_t> facets;
+		size_t vertexCount = 0;
+		size_t facetCount = 0;
+
+		template <typename Predicate>
+		std::vector<size_t> findEdges(Predicate predicate) const
+		{
+			std::vector<size_t> result;
+			for (size_t e = 0; e < edges.size(); e++)
+				if (predicate(getFacetCount(e)))
+					result.push_back(e);
+			return result;
+		}
+	};
+
+	// Recalculate the normals of all facets from their vertices, degenerated facets get a zero normal
+	template<template<typename> class Allocator>
+	void computeFacetNormals(BasicFVMesh<Allocator>& mesh)
+	{
+		for (auto& f : mesh.facets)
+		{
+			const Vertex& a = mesh.vertices[f.v1];
+			const Vertex& b = mesh.vertices[f.v2];
+			const Vertex& c = mesh.vertices[f.v3];
+			const float v1[3] = { a.x, a.y, a.z };
+			const float v2[3] = { b.x, b.y, b.z };
+			const float v3[3] = { c.x, c.y, c.z };
+			float n[3];
+			Reader::calculateNormals(v1, v2, v3, n);
+			f.n = Normal{ n[0], n[1], n[2] };
+		}
+		mesh.pendingNormals.clear();
+	}
+
+	// Quadric error metric as symmetric 4x4 matrix, only the upper triangle is stored.
+	// The error of a position is the weighted sum of the squared distances to all planes of the quadric.
+	struct Quadric
+	{
+		double a[10] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+
+		// Quadric of the plane n * p + d = 0 with a unit normal vector n
+		static Quadric fromPlane(double nx, double ny, double nz, double d, double weight)
+		{
+			Quadric q;
+			q.a[0] = weight * nx * nx; q.a[1] = weight * nx * ny; q.a[2] = weight * nx * nz; q.a[3] = weight * nx * d;
+			q.a[4] = weight * ny * ny; q.a[5] = weight * ny * nz; q.a[6] = weight * ny * d;
+			q.a[7] = weight * nz * nz; q.a[8] = weight * nz * d;
+			q.a[9] = weight * d * d;
+			return q;
+		}
+
+		// Area weighted quadric of the plane of a facet, degenerated facets return an empty quadric
+		static Quadric fromFacet(const double p1[3], const double p2[3], const double p3[3])
+		{
+			double u[3] = { p2[0] - p1[0], p2[1] - p1[1], p2[2] - p1[2] };
+			double v[3] = { p3[0] - p1[0], p3[1] - p1[1], p3[2] - p1[2] };
+			double n[3] = { u[1] * v[2] - u[2] * v[1], u[2] * v[0] - u[0] * v[2], u[0] * v[1] - u[1] * v[0] };
+			double length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+			if (!(length > 0.0))
+				return Quadric();
+			n[0] /= length; n[1] /= length; n[2] /= length;
+			return fromPlane(n[0], n[1], n[2], -(n[0] * p1[0] + n[1] * p1[1] + n[2] * p1[2]), 0.5 * length);
+		}
+
+		Quadric& operator+=(const Quadric& other)
+		{
+			for (int i = 0; i < 10; i++)
+				a[i] += other.a[i];
+			return *this;
+		}
+
+		double evaluate(const double p[3]) const
+		{
+			const double x = p[0], y = p[1], z = p[2];
+			return a[0] * x * x + 2 * a[1] * x * y + 2 * a[2] * x * z + 2 * a[3] * x +
+				a[4] * y * y + 2 * a[5] * y * z + 2 * a[6] * y + a[7] * z * z + 2 * a[8] * z + a[9];
+		}
+
+		// Find the position with the minimal error, returns false if the system is ill-conditioned
+		bool optimize(double p[3]) const
+		{
+			const double m00 = a[0], m01 = a[1], m02 = a[2], m11 = a[4], m12 = a[5], m22 = a[7];
+			const double c00 = m11 * m22 - m12 * m12;
+			const double c01 = m02 * m12 - m01 * m22;
+			const double c02 = m01 * m12 - m02 * m11;
+			const double det = m00 * c00 + m01 * c01 + m02 * c02;
+			const double trace = m00 + m11 + m22;
+			if (!(std::abs(det) > 1e-9 * trace * trace * trace))
+				return false;
+			const double b[3] = { -a[3], -a[6], -a[8] };
+			const double c11 = m00 * m22 - m02 * m02;
+			const double c12 = m01 * m02 - m00 * m12;
+			const double c22 = m00 * m11 - m01 * m01;
+			p[0] = (c00 * b[0] + c01 * b[1] + c02 * b[2]) / det;
+			p[1] = (c01 * b[0] + c11 * b[1] + c12 * b[2]) / det;
+			p[2] = (c02 * b[0] + c12 * b[1] + c22 * b[2]) / det;
+			return std::isfinite(p[0]) && std::isfinite(p[1]) && std::isfinite(p[2]);
+		}
+	};
+
+	// Settings for the mesh decimation with edge collapses
+	struct DecimationSettings
+	{
+		// Stop when the number of facets is reached, zero means no limit
+		size_t targetFacetCount = 0;
+
+		// Stop when the cheapest collapse would exceed this quadric error (weighted squared distance)
+		double maxError = INFINITY;
+
+		// Add constraint planes at the open edges so that the mesh boundary keeps its shape
+		bool preserveBoundary = true;
+
+		// Threads for building the edge adjacency, zero will use all hardware threads
+		size_t threadCount = 0;
+	};
+
+	// Reduce the number of facets with quadric error metric edge collapses as described in
+	// "Surface Simplification Using Quadric Error Metrics" (Garland and Heckbert 1997).
+	// Collapses are taken from a binary heap with lazy invalidation, collapses that would flip facets
+	// or change the topology are rejected. The facet normals of the result are calculated from the geometry.
+	template<template<typename> class Allocator>
+	BasicFVMesh<Allocator> decimateMesh(const BasicFVMesh<Allocator>& mesh, const DecimationSettings& settings = DecimationSettings(),
+		const typename BasicFVMesh<Allocator>::allocator_type& allocator = {})
+	{
+		const size_t vertexCount = mesh.vertices.size();
+		if (vertexCount > std::numeric_limits<uint32_t>::max())
+			throw std::runtime_error("Too many vertices for the decimation");
+
+		std::vector<std::array<double, 3>> positions(vertexCount);
+		for (size_t v = 0; v < vertexCount; v++)
+			positions[v] = { mesh.vertices[v].x, mesh.vertices[v].y, mesh.vertices[v].z };
+		std::vector<std::array<uint32_t, 3>> facets(mesh.facets.size());
+		std::vector<bool> facetAlive(mesh.facets.size(), true);
+		std::vector<std::vector<uint32_t>> vertexFacets(vertexCount);
+		std::vector<Quadric> quadrics(vertexCount);
+		size_t liveFacets = 0;
+		for (size_t t = 0; t < mesh.facets.size(); t++)
+		{
+			const auto& f = mesh.facets[t];
+			facets[t] = { static_cast<uint32_t>(f.v1), static_cast<uint32_t>(f.v2), static_cast<uint32_t>(f.v3) };
+			if (f.v1 == f.v2 || f.v2 == f.v3 || f.v1 == f.v3)
+			{
+				facetAlive[t] = false;
+				continue;
+			}
+			liveFacets++;
+			Quadric q = Quadric::fromFacet(positions[f.v1].data(), positions[f.v2].data(), positions[f.v3].data());
+			for (uint32_t v : facets[t])
+			{
+				quadrics[v] += q;
+				vertexFacets[v].push_back(static_cast<uint32_t>(t));
+			}
+		}
+
+		// Edges and boundary constraints
+		EdgeAdjacency adjacency(mesh, settings.threadCount);
+		for (size_t e = 0; settings.preserveBoundary && e < adjacency.getEdgeCount(); e++)
+		{
+			if (adjacency.getFacetCount(e) != 1)
+				continue;
+			const auto& edge = adjacency.getEdge(e);
+			const auto& f = facets[adjacency.getFacets(e)[0]];
+			const double* a = positions[edge.v1].data();
+			const double* b = positions[edge.v2].data();
+			const double* c = positions[f[0] != edge.v1 && f[0] != edge.v2 ? f[0] : (f[1] != edge.v1 && f[1] != edge.v2 ? f[1] : f[2])].data();
+			double d[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+			double w[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+			double n[3] = { d[1] * w[2] - d[2] * w[1], d[2] * w[0] - d[0] * w[2], d[0] * w[1] - d[1] * w[0] };
+			double m[3] = { d[1] * n[2] - d[2] * n[1], d[2] * n[0] - d[0] * n[2], d[0] * n[1] - d[1] * n[0] };
+			double length = std::sqrt(m[0] * m[0] + m[1] * m[1] + m[2] * m[2]);
+			if (!(length > 0.0))
+				continue;
+			m[0] /= length; m[1] /= length; m[2] /= length;
+			double edgeLength2 = d[0] * d[0] + d[1] * d[1] + d[2] * d[2];
+			Quadric q = Quadric::fromPlane(m[0], m[1], m[2], -(m[0] * a[0] + m[1] * a[1] + m[2] * a[2]), 1000.0 * edgeLength2);
+			quadrics[edge.v1] += q;
+			quadrics[edge.v2] += q;
+		}
+
+		// Compact heap entries, entries become invalid when the version of a vertex changes
+		struct Candidate { float cost; uint32_t a, b, versionA, versionB; };
+		auto greater = [](const Candidate& x, const Candidate& y) { return x.cost > y.cost; };
+		std::vector<Candidate> heap;
+		std::vector<uint32_t> versions(vertexCount, 0);
+		std::vector<bool> vertexAlive(vertexCount, true);
+
+		auto findTarget = [&](uint32_t a, uint32_t b, double p[3])
+		{
+			Quadric q = quadrics[a];
+			q += quadrics[b];
+			if (q.optimize(p))
+				return std::max(0.0, q.evaluate(p));
+			const double* pa = positions[a].data();
+			const double* pb = positions[b].data();
+			const double mid[3] = { (pa[0] + pb[0]) * 0.5, (pa[1] + pb[1]) * 0.5, (pa[2] + pb[2]) * 0.5 };
+			double best = INFINITY;
+			for (const double* option : { pa, pb, mid })
+			{
+				double error = q.evaluate(option);
+				if (error < best)
+				{
+					best = error;
+					p[0] = option[0]; p[1] = option[1]; p[2] = option[2];
+				}
+			}
+			return std::max(0.0, best);
+		};
+		auto pushCandidate = [&](uint32_t a, uint32_t b)
+		{
+			double p[3];
+			float cost = static_cast<float>(findTarget(a, b, p));
+			heap.push_back(Candidate{ cost, a, b, versions[a], versions[b] });
+			std::push_heap(heap.begin(), heap.end(), greater);
+		};
+		for (size_t e = 0; e < adjacency.getEdgeCount(); e++)
+		{
+			const auto& edge = adjacency.getEdge(e);
+			double p[3];
+			float cost = static_cast<float>(findTarget(static_cast<uint32_t>(edge.v1), static_cast<uint32_t>(edge.v2), p));
+			heap.push_back(Candidate{ cost, static_cast<uint32_t>(edge.v1), static_cast<uint32_t>(edge.v2), 0, 0 });
+		}
+		std::make_heap(heap.begin(), heap.end(), greater);
+		adjacency = EdgeAdjacency();
+
+		auto otherVertices = [&](uint32_t v, std::vector<uint32_t>& output)
+		{
+			output.clear();
+			for (uint32_t t : vertexFacets[v])
+				for (uint32_t w : facets[t])
+					if (w != v)
+						output.push_back(w);
+			std::sort(output.begin(), output.end());
+			output.erase(std::unique(output.begin(), output.end()), output.end());
+		};
+
+		std::vector<uint32_t> neighborsA, neighborsB, shared;
+		while (!heap.empty() && liveFacets > settings.targetFacetCount)
+		{
+			std::pop_heap(heap.begin(), heap.end(), greater);
+			Candidate c = heap.back();
+			heap.pop_back();
+			if (!vertexAlive[c.a] || !vertexAlive[c.b] || versions[c.a] != c.versionA || versions[c.b] != c.versionB)
+				continue;
+			if (c.cost > settings.maxError)
+				break;
+
+			// Facets at the edge are removed by the collapse
+			shared.clear();
+			for (uint32_t t : vertexFacets[c.a])
+			{
+				const auto& f = facets[t];
+				if (f[0] == c.b || f[1] == c.b || f[2] == c.b)
+					shared.push_back(t);
+			}
+			if (shared.empty())
+				continue;
+
+			// Link condition: the vertices must share only the opposite vertices of the removed facets
+			otherVertices(c.a, neighborsA);
+			otherVertices(c.b, neighborsB);
+			size_t common = 0;
+			for (size_t i = 0, j = 0; i < neighborsA.size() && j < neighborsB.size();)
+			{
+				if (neighborsA[i] < neighborsB[j]) i++;
+				else if (neighborsA[i] > neighborsB[j]) j++;
+				else { common++; i++; j++; }
+			}
+			if (common != shared.size())
+				continue;
+
+			// Reject collapses that would flip the orientation of the remaining facets
+			double p[3];
+			findTarget(c.a, c.b, p);
+			bool flipped = false;
+			for (uint32_t v : { c.a, c.b })
+			{
+				for (uint32_t t : vertexFacets[v])
+				{
+					if (std::find(shared.begin(), shared.end(), t) != shared.end())
+						continue;
+					const double* corners[3];
+					const double* moved[3];
+					for (int k = 0; k < 3; k++)
+					{
+						corners[k] = positions[facets[t][k]].data();
+						moved[k] = facets[t][k] == v ? p : corners[k];
+					}
+					auto normal = [](const double* const q[3], double n[3])
+					{
+						double u[3] = { q[1][0] - q[0][0], q[1][1] - q[0][1], q[1][2] - q[0][2] };
+						double w[3] = { q[2][0] - q[0][0], q[2][1] - q[0][1], q[2][2] - q[0][2] };
+						n[0] = u[1] * w[2] - u[2] * w[1];
+						n[1] = u[2] * w[0] - u[0] * w[2];
+						n[2] = u[0] * w[1] - u[1] * w[0];
+					};
+					double before[3], after[3];
+					normal(corners, before);
+					normal(moved, after);
+					if (before[0] * after[0] + before[1] * after[1] + before[2] * after[2] <= 0.0)
+						flipped = true;
+				}
+			}
+			if (flipped)
+				continue;
+
+			// Collapse vertex b into vertex a
+			for (uint32_t t : shared)
+			{
+				facetAlive[t] = false;
+				liveFacets--;
+				for (uint32_t w : facets[t])
+				{
+					auto& list = vertexFacets[w];
+					list.erase(std::remove(list.begin(), list.end(), t), list.end());
+				}
+			}
+			for (uint32_t t : vertexFacets[c.b])
+			{
+				for (auto& w : facets[t])
+					if (w == c.b)
+						w = c.a;
+				vertexFacets[c.a].push_back(t);
+			}
+			vertexFacets[c.b].clear();
+			vertexFacets[c.b].shrink_to_fit();
+			positions[c.a] = { p[0], p[1], p[2] };
+			quadrics[c.a] += quadrics[c.b];
+			vertexAlive[c.b] = false;
+			versions[c.a]++;
+			versions[c.b]++;
+
+			otherVertices(c.a, neighborsA);
+			for (uint32_t w : neighborsA)
+				pushCandidate(c.a, w);
+		}
+
+		// Compact the remaining vertices and facets
+		BasicFVMesh<Allocator> result(allocator);
+		std::vector<size_t> remap(vertexCount, std::numeric_limits<size_t>::max());
+		for (size_t t = 0; t < facets.size(); t++)
+		{
+			if (!facetAlive[t])
+				continue;
+			FVFacet facet{};
+			size_t* indices[3] = { &facet.v1, &facet.v2, &facet.v3 };
+			for (int k = 0; k < 3; k++)
+			{
+				uint32_t v = facets[t][k];
+				if (remap[v] == std::numeric_limits<size_t>::max())
+				{
+					remap[v] = result.vertices.size();
+					result.vertices.push_back(Vertex{ static_cast<float>(positions[v][0]), static_cast<float>(positions[v][1]), static_cast<float>(positions[v][2]) });
+				}
+				*indices[k] = remap[v];
+			}
+			result.facets.push_back(facet);
+		}
+		computeFacetNormals(result);
+		return result;
+	}
+
+	// Fast decimation for very large meshes that merges all vertices inside the cells of a uniform grid.
+	// The grid resolution is the number of cells along the largest side of the bounding box.
+	// Each cell gets the position with the minimal quadric error of its vertices, facets that collapse are removed.
+	// All steps run on multiple threads and the result does not depend on the thread count.
+	template<template<typename> class Allocator>
+	BasicFVMesh<Allocator> decimateMeshClustered(const BasicFVMesh<Allocator>& mesh, size_t gridResolution, size_t threadCount = 0,
+		const typename BasicFVMesh<Allocator>::allocator_type& allocator = {})
+	{
+		if (gridResolution == 0 || gridResolution > (1u << 21))
+			throw std::runtime_error("Invalid grid resolution for the decimation");
+
+		const size_t vertexCount = mesh.vertices.size();
+		double minimum[3] = { INFINITY, INFINITY, INFINITY };
+		double maximum[3] = { -INFINITY, -INFINITY, -INFINITY };
+		for (const auto& v : mesh.vertices)
+		{
+			const double c[3] = { v.x, v.y, v.z };
+			for (int axis = 0; axis < 3; axis++)
+			{
+				if (std::isfinite(c[axis]))
+				{
+					minimum[axis] = std::min(minimum[axis], c[axis]);
+					maximum[axis] = std::max(maximum[axis], c[axis]);
+				}
+			}
+		}
+		double extent = 0.0;
+		for (int axis = 0; axis < 3; axis++)
+			extent = std::max(extent, maximum[axis] - minimum[axis]);
+		const double cellSize = extent > 0.0 ? extent / gridResolution : 1.0;
+
+		// Sort the vertices by their cells to get contiguous clusters
+		struct CellVertex { uint64_t cell; size_t vertex; };
+		std::vector<CellVertex> cells(vertexCount);
+		parallelFor(vertexCount, threadCount, [&](size_t begin, size_t end)
+		{
+			for (size_t v = begin; v < end; v++)
+			{
+				const double c[3] = { mesh.vertices[v].x, mesh.vertices[v].y, mesh.vertices[v].z };
+				uint64_t key = 0;
+				for (int axis = 0; axis < 3; axis++)
+				{
+					double index = std::isfinite(c[axis]) ? std::floor((c[axis] - minimum[axis]) / cellSize) : 0.0;
+					key |= static_cast<uint64_t>(std::clamp(index, 0.0, static_cast<double>(gridResolution - 1))) << (21 * axis);
+				}
+				cells[v] = CellVertex{ key, v };
+			}
+		});
+		parallelSort(cells, threadCount, [](const CellVertex& a, const CellVertex& b)
+		{
+			return a.cell < b.cell || (a.cell == b.cell && a.vertex < b.vertex);
+		});
+		std::vector<size_t> clusterOffsets;
+		std::vector<size_t> clusterOf(vertexCount);
+		for (size_t i = 0; i < cells.size(); i++)
+		{
+			if (i == 0 || cells[i].cell != cells[i - 1].cell)
+				clusterOffsets.push_back(i);
+			clusterOf[cells[i].vertex] = clusterOffsets.size() - 1;
+		}
+		clusterOffsets.push_back(cells.size());
+		const size_t clusterCount = clusterOffsets.size() - 1;
+
+		// Representative position of each cluster from the quadrics of the facets around its vertices
+		auto vertexFacets = computeVertexFacetAdjacency(mesh);
+		BasicFVMesh<Allocator> result(allocator);
+		result.vertices.resize(clusterCount);
+		parallelFor(clusterCount, threadCount, [&](size_t begin, size_t end)
+		{
+			for (size_t c = begin; c < end; c++)
+			{
+				Quadric q;
+				double mean[3] = { 0, 0, 0 };
+				for (size_t i = clusterOffsets[c]; i < clusterOffsets[c + 1]; i++)
+				{
+					size_t v = cells[i].vertex;
+					mean[0] += mesh.vertices[v].x;
+					mean[1] += mesh.vertices[v].y;
+					mean[2] += mesh.vertices[v].z;
+					for (size_t j = vertexFacets.offsets[v]; j < vertexFacets.offsets[v + 1]; j++)
+					{
+						const auto& f = mesh.facets[vertexFacets.facets[j]];
+						const double p1[3] = { mesh.vertices[f.v1].x, mesh.vertices[f.v1].y, mesh.vertices[f.v1].z };
+						const double p2[3] = { mesh.vertices[f.v2].x, mesh.vertices[f.v2].y, mesh.vertices[f.v2].z };
+						const double p3[3] = { mesh.vertices[f.v3].x, mesh.vertices[f.v3].y, mesh.vertices[f.v3].z };
+						q += Quadric::fromFacet(p1, p2, p3);
+					}
+				}
+				double count = static_cast<double>(clusterOffsets[c + 1] - clusterOffsets[c]);
+				double p[3] = { mean[0] / count, mean[1] / count, mean[2] / count };
+
+				// The optimal position is only used when it stays close to the cell
+				double optimal[3];
+				if (q.optimize(optimal))
+				{
+					bool inside = true;
+					for (int axis = 0; axis < 3; axis++)
+						inside = inside && std::abs(optimal[axis] - p[axis]) <= cellSize;
+					if (inside)
+						p[0] = optimal[0], p[1] = optimal[1], p[2] = optimal[2];
+				}
+				result.vertices[c] = Vertex{ static_cast<float>(p[0]), static_cast<float>(p[1]), static_cast<float>(p[2]) };
+			}
+		});
+
+		// Keep facets with three different clusters and remove duplicates
+		struct ClusterFacet { size_t v[3]; size_t facet; };
+		std::vector<ClusterFacet> clusterFacets(mesh.facets.size());
+		std::vector<bool> keep(mesh.facets.size(), false);
+		parallelFor(mesh.facets.size(), threadCount, [&](size_t begin, size_t end)
+		{
+			for (size_t t = begin; t < end; t++)
+			{
+				const auto& f = mesh.facets[t];
+				size_t a = clusterOf[f.v1], b = clusterOf[f.v2], c = clusterOf[f.v3];
+				// Rotate the smallest index to the front without changing the orientation
+				if (b < a && b < c)
+					clusterFacets[t] = ClusterFacet{ { b, c, a }, t };
+				else if (c < a && c < b)
+					clusterFacets[t] = ClusterFacet{ { c, a, b }, t };
+				else
+					clusterFacets[t] = ClusterFacet{ { a, b, c }, t };
+			}
+		});
+		parallelSort(clusterFacets, threadCount, [](const ClusterFacet& x, const ClusterFacet& y)
+		{
+			return std::tie(x.v[0], x.v[1], x.v[2], x.facet) < std::tie(y.v[0], y.v[1], y.v[2], y.facet);
+		});
+		for (size_t i = 0; i < clusterFacets.size(); i++)
+		{
+			const auto& f = clusterFacets[i];
+			bool degenerated = f.v[0] == f.v[1] || f.v[1] == f.v[2] || f.v[0] == f.v[2];
+			bool duplicate = i > 0 && std::equal(f.v, f.v + 3, clusterFacets[i - 1].v);
+			keep[f.facet] = !degenerated && !duplicate;
+		}
+		for (size_t t = 0; t < mesh.facets.size(); t++)
+		{
+			if (!keep[t])
+				continue;
+			const auto& f = mesh.facets[t];
+			result.facets.push_back(FVFacet{ clusterOf[f.v1], clusterOf[f.v2], clusterOf[f.v3], Normal{ 0, 0, 0 } });
+		}
+
+		// Remove clusters without facets
+		std::vector<size_t> remap(clusterCount, std::numeric_limits<size_t>::max());
+		decltype(result.vertices) vertices(allocator);
+		for (auto& f : result.facets)
+		{
+			for (size_t* v : { &f.v1, &f.v2, &f.v3 })
+			{
+				if (remap[*v] == std::numeric_limits<size_t>::max())
+				{
+					remap[*v] = vertices.size();
+					vertices.push_back(result.vertices[*v]);
+				}
+				*v = remap[*v];
+			}
+		}
+		result.vertices.swap(vertices);
+		computeFacetNormals(result);
+		return result;
+	}
+
+	// Contours of a mesh sliced with horizontal planes, stored in compact arrays.
+	// The points of contour c are points[contourOffsets[c]] to points[contourOffsets[c + 1] - 1] and
+	// the contours of layer l are contourOffsets[layerOffsets[l]] to contourOffsets[layerOffsets[l + 1] - 1].
+	// Closed contours do not repeat their first point, outer contours are counter-clockwise seen from above.
+	struct Slices
+	{
+		struct Point { float x, y; };
+
+		std::vector<float> heights;
+		std::vector<size_t> layerOffsets; // First contour of each layer with an additional end offset
+		std::vector<size_t> contourOffsets; // First point of each contour with an additional end offset
+		std::vector<uint8_t> closed; // Open contours are only created by meshes with holes
+		std::vector<Point> points;
+
+		size_t getLayerCount() const { return heights.size(); }
+		size_t getContourCount() const { return closed.size(); }
+
+		static inline const size_t MAX_LAYERS = 1 << 24;
+	};
+
+	// Slice a mesh at the given ascending heights. Facets are bucketed by their Z extent once,
+	// then all layers are processed in parallel. The intersections are chained into contours by the
+	// mesh edges they lie on, so the vertices of the mesh should be deduplicated.
+	// Vertices exactly on a plane count as above it.
+	template<template<typename> class Allocator>
+	Slices sliceMesh(const BasicFVMesh<Allocator>& mesh, const std::vector<float>& heights, size_t threadCount = 0)
+	{
+		if (mesh.vertices.size() > std::numeric_limits<uint32_t>::max())
+			throw std::runtime_error("Too many vertices for slicing");
+		if (!std::is_sorted(heights.begin(), heights.end()))
+			throw std::runtime_error("Slice heights must be in ascending order");
+
+		// Bucket the facets to all layers within their Z extent
+		const size_t layerCount = heights.size();
+		std::vector<size_t> layerFacetOffsets(layerCount + 1, 0);
+		std::vector<std::pair<size_t, size_t>> facetLayers(mesh.facets.size());
+		for (size_t t = 0; t < mesh.facets.size(); t++)
+		{
+			const auto& f = mesh.facets[t];
+			float z1 = mesh.vertices[f.v1].z, z2 = mesh.vertices[f.v2].z, z3 = mesh.vertices[f.v3].z;
+			float minimum = std::min({ z1, z2, z3 });
+			float maximum = std::max({ z1, z2, z3 });
+			// Layers with minimum < height <= maximum are crossed by the facet
+			size_t first = std::upper_bound(heights.begin(), heights.end(), minimum) - heights.begin();
+			size_t last = std::upper_bound(heights.begin(), heights.end(), maximum) - heights.begin();
+			facetLayers[t] = { first, last };
+			for (size_t l = first; l < last; l++)
+				layerFacetOffsets[l + 1]++;
+		}
+		for (size_t l = 0; l < layerCount; l++)
+			layerFacetOffsets[l + 1] += layerFacetOffsets[l];
+		std::vector<size_t> layerFacets(layerFacetOffsets.back());
+		{
+			std::vector<size_t> positions(layerFacetOffsets.begin(), layerFacetOffsets.end() - 1);
+			for (size_t t = 0; t < mesh.facets.size(); t++)
+				for (size_t l = facetLayers[t].first; l < facetLayers[t].second; l++)
+					layerFacets[positions[l]++] = t;
+		}
+		facetLayers = std::vector<std::pair<size_t, size_t>>();
+
+		// Each segment connects the intersection points on two mesh edges identified by their sorted vertex indices
+		struct Segment { uint64_t from; uint64_t to; };
+		struct Layer { std::vector<size_t> contourSizes; std::vector<uint8_t> closed; std::vector<Slices::Point> points; };
+		std::vector<Layer> layers(layerCount);
+		parallelFor(layerCount, threadCount, [&](size_t begin, size_t end)
+		{
+			std::vector<Segment> segments;
+			std::vector<uint64_t> targets;
+			std::vector<uint8_t> used;
+			for (size_t l = begin; l < end; l++)
+			{
+				const float height = heights[l];
+				segments.clear();
+				for (size_t i = layerFacetOffsets[l]; i < layerFacetOffsets[l + 1]; i++)
+				{
+					const auto& f = mesh.facets[layerFacets[i]];
+					const size_t corners[4] = { f.v1, f.v2, f.v3, f.v1 };
+					uint64_t entering = 0, leaving = 0;
+					int crossings = 0;
+					for (int k = 0; k < 3; k++)
+					{
+						bool belowA = mesh.vertices[corners[k]].z < height;
+						bool belowB = mesh.vertices[corners[k + 1]].z < height;
+						if (belowA == belowB)
+							continue;
+						uint64_t a = std::min(corners[k], corners[k + 1]);
+						uint64_t b = std::max(corners[k], corners[k + 1]);
+						(belowA ? entering : leaving) = (a << 32) | b;
+						crossings++;
+					}
+					if (crossings == 2)
+						segments.push_back(Segment{ leaving, entering });
+				}
+
+				// Chain the segments, starting at the ends of open contours and then with the closed contours
+				std::sort(segments.begin(), segments.end(), [](const Segment& a, const Segment& b) { return a.from < b.from; });
+				targets.resize(segments.size());
+				for (size_t i = 0; i < segments.size(); i++)
+					targets[i] = segments[i].to;
+				std::sort(targets.begin(), targets.end());
+				used.assign(segments.size(), 0);
+				auto findSegment = [&](uint64_t from)
+				{
+					auto it = std::lower_bound(segments.begin(), segments.end(), from, [](const Segment& s, uint64_t key) { return s.from < key; });
+					for (; it != segments.end() && it->from == from; ++it)
+						if (!used[it - segments.begin()])
+							return static_cast<size_t>(it - segments.begin());
+					return segments.size();
+				};
+				auto addPoint = [&](Layer& layer, uint64_t key)
+				{
+					const Vertex& a = mesh.vertices[key >> 32];
+					const Vertex& b = mesh.vertices[key & 0xFFFFFFFFu];
+					float t = (height - a.z) / (b.z - a.z);
+					layer.points.push_back(Slices::Point{ a.x + t * (b.x - a.x), a.y + t * (b.y - a.y) });
+				};
+				Layer& layer = layers[l];
+				for (int pass = 0; pass < 2; pass++)
+				{
+					for (size_t s = 0; s < segments.size(); s++)
+					{
+						if (used[s] || (pass == 0 && std::binary_search(targets.begin(), targets.end(), segments[s].from)))
+							continue;
+						const uint64_t start = segments[s].from;
+						size_t count = 0;
+						size_t current = s;
+						uint64_t key = start;
+						while (current != segments.size())
+						{
+							used[current] = 1;
+							addPoint(layer, key);
+							count++;
+							key = segments[current].to;
+							if (key == start)
+								break;
+							current = findSegment(key);
+						}
+						bool closed = key == start;
+						if (!closed)
+						{
+							addPoint(layer, key);
+							count++;
+						}
+						layer.contourSizes.push_back(count);
+						layer.closed.push_back(closed ? 1 : 0);
+					}
+				}
+			}
+		});
+
+		// Concatenate the layers
+		Slices slices;
+		slices.heights = heights;
+		slices.layerOffsets.push_back(0);
+		slices.contourOffsets.push_back(0);
+		for (auto& layer : layers)
+		{
+			for (size_t size : layer.contourSizes)
+				slices.contourOffsets.push_back(slices.contourOffsets.back() + size);
+			slices.closed.insert(slices.closed.end(), layer.closed.begin(), layer.closed.end());
+			slices.points.insert(slices.points.end(), layer.points.begin(), layer.points.end());
+			slices.layerOffsets.push_back(slices.closed.size());
+			layer = Layer();
+		}
+		return slices;
+	}
+
+	// Slice a mesh with equally spaced layers, the first plane is half a layer above the lowest vertex.
+	// Layer heights resulting in more than Slices::MAX_LAYERS layers are rejected.
+	template<template<typename> class Allocator>
+	Slices sliceMesh(const BasicFVMesh<Allocator>& mesh, float layerHeight, size_t threadCount = 0)
+	{
+		if (!(layerHeight > 0.0f) || !std::isfinite(layerHeight))
+			throw std::runtime_error("Invalid layer height for slicing");
+		float minimum = INFINITY, maximum = -INFINITY;
+		for (const auto& v : mesh.vertices)
+		{
+			minimum = std::min(minimum, v.z);
+			maximum = std::max(maximum, v.z);
+		}
+		double layerCount = std::ceil((static_cast<double>(maximum) - minimum) / layerHeight - 0.5);
+		if (layerCount > static_cast<double>(Slices::MAX_LAYERS))
+			throw std::runtime_error("Layer height results in too many layers for slicing");
+		std::vector<float> heights;
+		heights.reserve(layerCount > 0 ? static_cast<size_t>(layerCount) : 0);
+		for (size_t l = 0; minimum <= maximum; l++)
+		{
+			float height = static_cast<float>(minimum + (l + 0.5) * layerHeight);
+			if (height >= maximum)
+				break;
+			heights.push_back(height);
+		}
+		return sliceMesh(mesh, heights, threadCount);
+	}
+
+	// Settings for the spatial partitioning of meshes into tiles
+	struct TilingSettings
+	{
+		// Octree cells with more facets are split further, cells at the finest level may still exceed it
+		size_t maxFacetsPerTile = 1 << 20;
+
+		// Zero will use all hardware threads
+		size_t threadCount = 0;
+	};
+
+	// Tile of a mesh that is an octree cell. Each facet belongs to exactly one tile, the one that contains its centroid.
+	// The bounds of the facets can extend beyond the cell because of facets that straddle the cell borders.
+	struct MeshTile
+	{
+		uint32_t level; // Octree level of the cell, zero is the root cell
+		uint64_t mortonPrefix; // Morton code of the cell at its level
+		float cellMinimum[3];
+		float cellMaximum[3];
+		float boundsMinimum[3];
+		float boundsMaximum[3];
+		size_t facetOffset; // First entry of the tile in MeshTiling::facets
+		size_t facetCount;
+	};
+
+	// Balanced spatial partitioning of a mesh, the tiles are sorted along the Morton curve
+	struct MeshTiling
+	{
+		std::vector<MeshTile> tiles;
+		std::vector<size_t> facets; // Mesh facet indices of all tiles, contiguous for each tile
+	};
+
+	// Spread the lower 21 bits of a value so that there are two zero bits between them
+	uint64_t spreadMortonBits(uint64_t value)
+	{
+		value &= 0x1FFFFF;
+		value = (value | value << 32) & 0x1F00000000FFFFull;
+		value = (value | value << 16) & 0x1F0000FF0000FFull;
+		value = (value | value << 8) & 0x100F00F00F00F00Full;
+		value = (value | value << 4) & 0x10C30C30C30C30C3ull;
+		value = (value | value << 2) & 0x1249249249249249ull;
+		return value;
+	}
+
+	// Partition the facets of a mesh into octree cells using the Morton codes of the facet centroids.
+	// The function getFacet(index, corners) must write the nine coordinates of a facet and is called concurrently.
+	template<typename GetFacet>
+	MeshTiling partitionFacets(size_t facetCount, GetFacet&& getFacet, const TilingSettings& settings = TilingSettings())
+	{
+		if (settings.maxFacetsPerTile == 0)
+			throw std::runtime_error("Tiles must be able to hold at least one facet");
+		constexpr uint32_t BITS = 21;
+		constexpr double CELLS = double(1u << BITS);
+
+		// Cubic root cell around all finite centroids
+		std::vector<std::array<float, 3>> centroids(facetCount);
+		parallelFor(facetCount, settings.threadCount, [&](size_t begin, size_t end)
+		{
+			float corners[9];
+			for (size_t i = begin; i < end; i++)
+			{
+				getFacet(i, corners);
+				for (int axis = 0; axis < 3; axis++)
+					centroids[i][axis] = (corners[axis] + corners[axis + 3] + corners[axis + 6]) / 3.0f;
+			}
+		});
+		double minimum[3] = { INFINITY, INFINITY, INFINITY };
+		double maximum[3] = { -INFINITY, -INFINITY, -INFINITY };
+		for (const auto& c : centroids)
+		{
+			for (int axis = 0; axis < 3; axis++)
+			{
+				if (std::isfinite(c[axis]))
+				{
+					minimum[axis] = std::min(minimum[axis], double(c[axis]));
+					maximum[axis] = std::max(maximum[axis], double(c[axis]));
+				}
+			}
+		}
+		double size = 0.0;
+		for (int axis = 0; axis < 3; axis++)
+		{
+			if (!(minimum[axis] <= maximum[axis]))
+				minimum[axis] = maximum[axis] = 0.0;
+			size = std::max(size, maximum[axis] - minimum[axis]);
+		}
+		if (!(size > 0.0))
+			size = 1.0;
+
+		// Sort the facets along the Morton curve, non-finite centroids are clamped into the root cell
+		struct Entry { uint64_t code; size_t facet; };
+		std::vector<Entry> entries(facetCount);
+		parallelFor(facetCount, settings.threadCount, [&](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; i++)
+			{
+				uint64_t code = 0;
+				for (int axis = 0; axis < 3; axis++)
+				{
+					double cell = std::floor((centroids[i][axis] - minimum[axis]) / size * CELLS);
+					cell = std::isnan(cell) ? 0.0 : std::clamp(cell, 0.0, CELLS - 1.0);
+					code |= spreadMortonBits(static_cast<uint64_t>(cell)) << axis;
+				}
+				entries[i] = Entry{ code, i };
+			}
+		});
+		centroids = std::vector<std::array<float, 3>>();
+		parallelSort(entries, settings.threadCount, [](const Entry& a, const Entry& b)
+		{
+			return a.code < b.code || (a.code == b.code && a.facet < b.facet);
+		});
+
+		// Split the octree cells with too many facets, each cell is a contiguous range of the sorted codes
+		MeshTiling tiling;
+		tiling.facets.resize(facetCount);
+		for (size_t i = 0; i < facetCount; i++)
+			tiling.facets[i] = entries[i].facet;
+		std::function<void(size_t, size_t, uint32_t, uint64_t)> split = [&](size_t begin, size_t end, uint32_t level, uint64_t prefix)
+		{
+			if (end - begin <= settings.maxFacetsPerTile || level == BITS)
+			{
+				MeshTile tile{};
+				tile.level = level;
+				tile.mortonPrefix = prefix;
+				const double cellSize = size / double(1u << level);
+				for (int axis = 0; axis < 3; axis++)
+				{
+					uint64_t cell = 0;
+					for (uint32_t l = 0; l < level; l++)
+						cell |= ((prefix >> (3 * l + axis)) & 1) << l;
+					tile.cellMinimum[axis] = static_cast<float>(minimum[axis] + cell * cellSize);
+					tile.cellMaximum[axis] = static_cast<float>(minimum[axis] + (cell + 1) * cellSize);
+				}
+				tile.facetOffset = begin;
+				tile.facetCount = end - begin;
+				tiling.tiles.push_back(tile);
+				return;
+			}
+			const uint32_t shift = 3 * (BITS - level - 1);
+			for (uint64_t child = 0; child < 8; child++)
+			{
+				const uint64_t childPrefix = (prefix << 3) | child;
+				auto first = std::lower_bound(entries.begin() + begin, entries.begin() + end, childPrefix << shift,
+					[](const Entry& e, uint64_t code) { return e.code < code; });
+				auto last = std::lower_bound(first, entries.begin() + end, (childPrefix + 1) << shift,
+					[](const Entry& e, uint64_t code) { return e.code < code; });
+				if (first != last)
+					split(first - entries.begin(), last - entries.begin(), level + 1, childPrefix);
+			}
+		};
+		if (facetCount > 0)
+			split(0, facetCount, 0, 0);
+
+		// Bounds of the facets in each tile
+		parallelFor(tiling.tiles.size(), settings.threadCount, [&](size_t begin, size_t end)
+		{
+			float corners[9];
+			for (size_t t = begin; t < end; t++)
+			{
+				MeshTile& tile = tiling.tiles[t];
+				for (int axis = 0; axis < 3; axis++)
+				{
+					tile.boundsMinimum[axis] = INFINITY;
+					tile.boundsMaximum[axis] = -INFINITY;
+				}
+				for (size_t i = tile.facetOffset; i < tile.facetOffset + tile.facetCount; i++)
+				{
+					getFacet(tiling.facets[i], corners);
+					for (int k = 0; k < 9; k++)
+					{
+						tile.boundsMinimum[k % 3] = std::min(tile.boundsMinimum[k % 3], corners[k]);
+						tile.boundsMaximum[k % 3] = std::max(tile.boundsMaximum[k % 3], corners[k]);
+					}
+				}
+			}
+		});
+		return tiling;
+	}
+
+	template<template<typename> class Allocator>
+	MeshTiling partitionMesh(const BasicMesh<Allocator>& mesh, const TilingSettings& settings = TilingSettings())
+	{
+		return partitionFacets(mesh.facets.size(), [&](size_t index, float corners[9])
+		{
+			const Facet& f = mesh.facets[index];
+			corners[0] = f.v1.x; corners[1] = f.v1.y; corners[2] = f.v1.z;
+			corners[3] = f.v2.x; corners[4] = f.v2.y; corners[5] = f.v2.z;
+			corners[6] = f.v3.x; corners[7] = f.v3.y; corners[8] = f.v3.z;
+		}, settings);
+	}
+
+	template<template<typename> class Allocator>
+	MeshTiling partitionMesh(const BasicFVMesh<Allocator>& mesh, const TilingSettings& settings = TilingSettings())
+	{
+		return partitionFacets(mesh.facets.size(), [&](size_t index, float corners[9])
+		{
+			const FVFacet& f = mesh.facets[index];
+			const Vertex& a = mesh.vertices[f.v1];
+			const Vertex& b = mesh.vertices[f.v2];
+			const Vertex& c = mesh.vertices[f.v3];
+			corners[0] = a.x; corners[1] = a.y; corners[2] = a.z;
+			corners[3] = b.x; corners[4] = b.y; corners[5] = b.z;
+			corners[6] = c.x; corners[7] = c.y; corners[8] = c.z;
+		}, settings);
+	}
+
+	// Copy the facets of a tile into a separate mesh
+	template<template<typename> class Allocator>
+	BasicMesh<Allocator> extractTile(const BasicMesh<Allocator>& mesh, const MeshTiling& tiling, size_t tile,
+		const typename BasicMesh<Allocator>::allocator_type& allocator = {})
+	{
+		const MeshTile& t = tiling.tiles.at(tile);
+		BasicMesh<Allocator> result(allocator);
+		result.facets.reserve(t.facetCount);
+		for (size_t i = t.facetOffset; i < t.facetOffset + t.facetCount; i++)
+		{
+			result.facets.push_back(mesh.facets[tiling.facets[i]]);
+			result.facets.back().n = getFacetNormal(mesh, tiling.facets[i]);
+		}
+		return result;
+	}
+
+	// Copy the facets of a tile and the vertices they use into a separate face-vertex mesh
+	template<template<typename> class Allocator>
+	BasicFVMesh<Allocator> extractTile(const BasicFVMesh<Allocator>& mesh, const MeshTiling& tiling, size_t tile,
+		const typename BasicFVMesh<Allocator>::allocator_type& allocator = {})
+	{
+		const MeshTile& t = tiling.tiles.at(tile);
+		BasicFVMesh<Allocator> result(allocator);
+		result.facets.reserve(t.facetCount);
+		// A sorted list of the used vertices keeps the memory proportional to the tile instead of the whole mesh
+		std::vector<size_t> remap;
+		remap.reserve(t.facetCount * 3);
+		for (size_t i = t.facetOffset; i < t.facetOffset + t.facetCount; i++)
+		{
+			const FVFacet& facet = mesh.facets[tiling.facets[i]];
+			remap.insert(remap.end(), { facet.v1, facet.v2, facet.v3 });
+		}
+		std::sort(remap.begin(), remap.end());
+		remap.erase(std::unique(remap.begin(), remap.end()), remap.end());
+		result.vertices.reserve(remap.size());
+		for (size_t v : remap)
+			result.vertices.push_back(mesh.vertices[v]);
+		for (size_t i = t.facetOffset; i < t.facetOffset + t.facetCount; i++)
+		{
+			FVFacet facet = mesh.facets[tiling.facets[i]];
+			facet.n = getFacetNormal(mesh, tiling.facets[i]);
+			for (size_t* v : { &facet.v1, &facet.v2, &facet.v3 })
+				*v = std::lower_bound(remap.begin(), remap.end(), *v) - remap.begin();
+			result.facets.push_back(facet);
+		}
+		return result;
+	}
+
+	// Provider that writes a subset of the facets of another provider
+	struct SubsetProvider : microstl::Writer::Provider
+	{
+		microstl::Writer::Provider& source;
+		const size_t* indices;
+		size_t count;
+
+		SubsetProvider(microstl::Writer::Provider& sourceProvider, const size_t* facetIndices, size_t facetCount)
+			: source(sourceProvider), indices(facetIndices), count(facetCount) {}
+		bool asciiMode() override { return source.asciiMode(); }
+		std::string getName() override { return source.getName(); }
+		void getHeader(uint8_t header[80]) override { source.getHeader(header); }
+		bool nullifyNormals() override { return source.nullifyNormals(); }
+		bool writeAttributes() override { return source.writeAttributes(); }
+		size_t getFacetCount() override { return count; }
+		bool threadSafe() override { return source.threadSafe(); }
+
+		void getFacet(size_t index, float v1[3], float v2[3], float v3[3], float n[3]) override
+		{
+			source.getFacet(indices[index], v1, v2, v3, n);
+		}
+
+		void getFacetAttributes(size_t index, uint8_t attributes[2]) override
+		{
+			source.getFacetAttributes(indices[index], attributes);
+		}
+
+		bool onProgress(uint64_t bytes, uint64_t facets) override { return source.onProgress(bytes, facets); }
+	};
+
+	// Write each tile as its own STL file named tile_<index>.stl into a directory.
+	// The text file manifest.txt lists the file name, level, facet count, facet bounds and cell bounds of each tile.
+	Result writeTiles(const std::filesystem::path& directory, const MeshTiling& tiling, Writer::Provider& provider)
+	{
+		std::error_code error;
+		std::filesystem::create_directories(directory, error);
+		std::ofstream manifest(directory / "manifest.txt", std::ios::binary);
+		if (!manifest)
+			return Result::FileError;
+		manifest.precision(9);
+		manifest << "# file level facets minX minY minZ maxX maxY maxZ cellMinX cellMinY cellMinZ cellMaxX cellMaxY cellMaxZ\n";
+		for (size_t t = 0; t < tiling.tiles.size(); t++)
+		{
+			const MeshTile& tile = tiling.tiles[t];
+			char name[32];
+			snprintf(name, sizeof(name), "tile_%05zu.stl", t);
+			SubsetProvider subset(provider, tiling.facets.data() + tile.facetOffset, tile.facetCount);
+			Result result = Writer::writeStlFile(directory / name, subset);
+			if (result != Result::Success)
+				return result;
+			manifest << name << " " << tile.level << " " << tile.facetCount;
+			for (const float* values : { tile.boundsMinimum, tile.boundsMaximum, tile.cellMinimum, tile.cellMaximum })
+				manifest << " " << values[0] << " " << values[1] << " " << values[2];
+			manifest << "\n";
+		}
+		manifest.flush();
+		return manifest ? Result::Success : Result::FileError;
+	}
+
+	// Bounding volume hierarchy over the facets of a mesh to accelerate spatial queries.
+	// The tree is built with a binned SAH and stored as flat node array in depth-first order.
+	// All facet indices returned by the queries refer to the facets of the original mesh.
+	class BVH
+	{
+	public:
+		struct Box { Vertex min; Vertex max; };
+		struct Ray { Vertex origin; Vertex direction; float maxDistance = INFINITY; };
+		struct RayHit { bool hit = false; size_t facet = 0; float distance = INFINITY; float u = 0; float v = 0; };
+		struct PointHit { bool hit = false; size_t facet = 0; Vertex point = { 0, 0, 0 }; float distance = INFINITY; };
+
+		BVH() {}
+
+		// Build the hierarchy for a mesh, a thread count of zero will use all hardware threads
+		template<template<typename> class Allocator>
+		BVH(const BasicMesh<Allocator>& mesh, size_t threadCount = 0)
+		{
+			std::vector<std::array<float, 9>> input(mesh.facets.size());
+			for (size_t i = 0; i < input.size(); i++)
+			{
+				const auto& f = mesh.facets[i];
+				input[i] = { f.v1.x, f.v1.y, f.v1.z, f.v2.x, f.v2.y, f.v2.z, f.v3.x, f.v3.y, f.v3.z };
+			}
+			build(input, threadCount);
+		}
+
+		// Build the hierarchy for a face-vertex mesh, a thread count of zero will use all hardware threads
+		template<template<typename> class Allocator>
+		BVH(const BasicFVMesh<Allocator>& mesh, size_t threadCount = 0)
+		{
+			std::vector<std::array<float, 9>> input(mesh.facets.size());
+			for (size_t i = 0; i < input.size(); i++)
+			{
+				const auto& f = mesh.facets[i];
+				const auto& v1 = mesh.vertices[f.v1];
+				const auto& v2 = mesh.vertices[f.v2];
+				const auto& v3 = mesh.vertices[f.v3];
+				input[i] = { v1.x, v1.y, v1.z, v2.x, v2.y, v2.z, v3.x, v3.y, v3.z };
+			}
+			build(input, threadCount);
+		}
+
+		size_t getNodeCount() const { return nodes.size(); }
+		size_t getFacetCount() const { return triangles.size(); }
+
+		Box getBounds() const
+		{
+			if (nodes.empty())
+				return Box{ { 0, 0, 0 }, { 0, 0, 0 } };
+			const Node& root = nodes[0];
+			return Box{ { root.min[0], root.min[1], root.min[2] }, { root.max[0], root.max[1], root.max[2] } };
+		}
+
+		// Finds the closest facet hit by the ray, both sides of the facets are considered.
+		// The direction does not need to be normalized, distances are measured in multiples of its length.
+		bool intersectRay(const Ray& ray, RayHit& hit) const
+		{
+			hit = RayHit();
+			if (nodes.empty())
+				return false;
+
+			const float o[3] = { ray.origin.x, ray.origin.y, ray.origin.z };
+			const float d[3] = { ray.direction.x, ray.direction.y, ray.direction.z };
+			const float inv[3] = { 1.0f / d[0], 1.0f / d[1], 1.0f / d[2] };
+			float tMax = ray.maxDistance, tLeft, tRight;
+			if (!rayBoxTest(nodes[0], o, inv, tMax, tLeft))
+				return false;
+
+			uint32_t stack[STACK_SIZE];
+			size_t stackSize = 0;
+			uint32_t current = 0;
+			while (true)
+			{
+				const Node& node = nodes[current];
+				if (node.count > 0)
+				{
+					for (uint32_t i = node.offset; i < node.offset + node.count; i++)
+					{
+						float t, u, v;
+						if (rayTriangleTest(triangles[i], o, d, t, u, v) && t < tMax)
+						{
+							tMax = t;
+							hit.hit = true;
+							hit.facet = facetIndices[i];
+							hit.distance = t;
+							hit.u = u;
+							hit.v = v;
+						}
+					}
+				}
+				else
+				{
+					uint32_t left = current + 1, right = node.offset;
+					bool hitLeft = rayBoxTest(nodes[left], o, inv, tMax, tLeft);
+					bool hitRight = rayBoxTest(nodes[right], o, inv, tMax, tRight);
+					if (hitLeft && hitRight)
+					{
+						if (tRight < tLeft)
+							std::swap(left, right);
+						stack[stackSize++] = right;
+						current = left;
+						continue;
+					}
+					else if (hitLeft || hitRight)
+					{
+						current = hitLeft ? left : right;
+						continue;
+					}
+				}
+
+				if (stackSize == 0)
+					break;
+				current = stack[--stackSize];
+			}
+
+			return hit.hit;
+		}
+
+		// Intersects a batch of rays in parallel, a thread count of zero will use all hardware threads
+		std::vector<RayHit> intersectRays(const std::vector<Ray>& rays, size_t threadCount = 0) const
+		{
+			std::vector<RayHit> hits(rays.size());
+			parallelFor(rays.size(), threadCount, [&](size_t begin, size_t end)
+			{
+				for (size_t i = begin; i < end; i++)
+					intersectRay(rays[i], hits[i]);
+			});
+			return hits;
+		}
+
+		// Finds the closest point on the surface of the mesh that is not further away than maxDistance
+		bool closestPoint(const Vertex& point, PointHit& hit, float maxDistance = INFINITY) const
+		{
+			hit = PointHit();
+			if (nodes.empty())
+				return false;
+
+			const float p[3] = { point.x, point.y, point.z };
+			float best = maxDistance * maxDistance;
+			uint32_t stack[STACK_SIZE];
+			size_t stackSize = 0;
+			stack[stackSize++] = 0;
+			while (stackSize > 0)
+			{
+				const Node& node = nodes[stack[--stackSize]];
+				if (boxDistanceSquared(node, p) > best)
+					continue;
+
+				if (node.count > 0)
+				{
+					for (uint32_t i = node.offset; i < node.offset + node.count; i++)
+					{
+						float c[3];
+						closestPointOnTriangle(triangles[i], p, c);
+						float distance = (c[0] - p[0]) * (c[0] - p[0]) + (c[1] - p[1]) * (c[1] - p[1]) + (c[2] - p[2]) * (c[2] - p[2]);
+						if (distance < best)
+						{
+							best = distance;
+							hit.hit = true;
+							hit.facet = facetIndices[i];
+							hit.point = { c[0], c[1], c[2] };
+						}
+					}
+				}
+				else
+				{
+					// Push the farther child first to visit the nearer one first
+					const uint32_t left = static_cast<uint32_t>(&node - nodes.data()) + 1, right = node.offset;
+					float distanceLeft = boxDistanceSquared(nodes[left], p);
+					float distanceRight = boxDistanceSquared(nodes[right], p);
+					if (distanceLeft < distanceRight)
+					{
+						if (distanceRight <= best)
+							stack[stackSize++] = right;
+						stack[stackSize++] = left;
+					}
+					else
+					{
+						if (distanceLeft <= best)
+							stack[stackSize++] = left;
+						stack[stackSize++] = right;
+					}
+				}
+			}
+
+			if (hit.hit)
+				hit.distance = sqrt(best);
+			return hit.hit;
+		}
+
+		// Finds the closest surface points for a batch of query points in parallel
+		std::vector<PointHit> closestPoints(const std::vector<Vertex>& points, size_t threadCount = 0, float maxDistance = INFINITY) const
+		{
+			std::vector<PointHit> hits(points.size());
+			parallelFor(points.size(), threadCount, [&](size_t begin, size_t end)
+			{
+				for (size_t i = begin; i < end; i++)
+					closestPoint(points[i], hits[i], maxDistance);
+			});
+			return hits;
+		}
+
+		// Collects the indices of all facets that intersect or touch the box
+		void overlapBox(const Box& box, std::vector<size_t>& facets) const
+		{
+			facets.clear();
+			if (nodes.empty())
+				return;
+
+			const float center[3] = { (box.min.x + box.max.x) / 2, (box.min.y + box.max.y) / 2, (box.min.z + box.max.z) / 2 };
+			const float half[3] = { (box.max.x - box.min.x) / 2, (box.max.y - box.min.y) / 2, (box.max.z - box.min.z) / 2 };
+			uint32_t stack[STACK_SIZE];
+			size_t stackSize = 0;
+			stack[stackSize++] = 0;
+			while (stackSize > 0)
+			{
+				uint32_t current = stack[--stackSize];
+				const Node& node = nodes[current];
+				if (node.min[0] > box.max.x || node.max[0] < box.min.x ||
+					node.min[1] > box.max.y || node.max[1] < box.min.y ||
+					node.min[2] > box.max.z || node.max[2] < box.min.z)
+					continue;
+
+				if (node.count > 0)
+				{
+					for (uint32_t i = node.offset; i < node.offset + node.count; i++)
+						if (triangleBoxTest(triangles[i], center, half))
+							facets.push_back(facetIndices[i]);
+				}
+				else
+				{
+					stack[stackSize++] = node.offset;
+					stack[stackSize++] = current + 1;
+				}
+			}
+		}
+
+		// Runs a batch of box overlap queries in parallel
+		std::vector<std::vector<size_t>> overlapBoxes(const std::vector<Box>& boxes, size_t threadCount = 0) const
+		{
+			std::vector<std::vector<size_t>> results(boxes.size());
+			parallelFor(boxes.size(), threadCount, [&](size_t begin, size_t end)
+			{
+				for (size_t i = begin; i < end; i++)
+					overlapBox(boxes[i], results[i]);
+			});
+			return results;
+		}
+
+		// Some build parameters
+		static inline const size_t MAX_LEAF_SIZE = 8u;
+		static inline const size_t BIN_COUNT = 16u;
+		static inline const size_t MAX_SAH_DEPTH = 48u;
+		static inline const size_t PARALLEL_BUILD_LIMIT = 16384u;
+
+	private:
+		// Inner nodes have a count of zero, their left child follows directly and the offset points to the right child.
+		// Leaf nodes store the offset and count of their triangles.
+		struct Node { float min[3]; uint32_t offset; float max[3]; uint32_t count; };
+		struct Primitive { float min[3]; float max[3]; float center[3]; };
+		static_assert(sizeof(Node) == 32, "Nodes should fit into half a cache line!");
+
+		// Beyond MAX_SAH_DEPTH only median splits are used, which limits the depth of the tree
+		static inline const size_t STACK_SIZE = MAX_SAH_DEPTH + 64u;
+
+		std::vector<Node> nodes;
+		std::vector<std::array<float, 9>> triangles;
+		std::vector<size_t> facetIndices;
+
+		void build(const std::vector<std::array<float, 9>>& input, size_t threadCount)
+		{
+			const size_t count = input.size();
+			if (count == 0)
+				return;
+			if (count >= std::numeric_limits<uint32_t>::max())
+				throw std::runtime_error("Too many facets for BVH!");
+
+			std::vector<Primitive> primitives(count);
+			parallelFor(count, threadCount, [&](size_t begin, size_t end)
+			{
+				for (size_t i = begin; i < end; i++)
+				{
+					const auto& t = input[i];
+					auto& p = primitives[i];
+					for (size_t a = 0; a < 3; a++)
+					{
+						p.min[a] = std::min(std::min(t[a], t[3 + a]), t[6 + a]);
+						p.max[a] = std::max(std::max(t[a], t[3 + a]), t[6 + a]);
+						p.center[a] = (p.min[a] + p.max[a]) / 2;
+					}
+				}
+			});
+
+			if (threadCount == 0)
+				threadCount = std::max<size_t>(1, std::thread::hardware_concurrency());
+			size_t parallelDepth = 0;
+			while ((size_t(1) << parallelDepth) < threadCount)
+				parallelDepth++;
+
+			std::vector<uint32_t> indices(count);
+			std::iota(indices.begin(), indices.end(), 0u);
+			nodes.reserve(2 * count / MAX_LEAF_SIZE + 1);
+			buildNode(primitives, indices, 0, count, 0, parallelDepth, nodes);
+			nodes.shrink_to_fit();
+
+			triangles.resize(count);
+			facetIndices.resize(count);
+			parallelFor(count, threadCount, [&](size_t begin, size_t end)
+			{
+				for (size_t i = begin; i < end; i++)
+				{
+					triangles[i] = input[indices[i]];
+					facetIndices[i] = indices[i];
+				}
+			});
+		}
+
+		static void buildNode(const std::vector<Primitive>& primitives, std::vector<uint32_t>& indices,
+			size_t begin, size_t end, size_t depth, size_t parallelDepth, std::vector<Node>& output)
+		{
+			Node node;
+			float centerMin[3], centerMax[3];
+			for (size_t a = 0; a < 3; a++)
+			{
+				node.min[a] = centerMin[a] = INFINITY;
+				node.max[a] = centerMax[a] = -INFINITY;
+			}
+			for (size_t i = begin; i < end; i++)
+			{
+				const auto& p = primitives[indices[i]];
+				for (size_t a = 0; a < 3; a++)
+				{
+					node.min[a] = std::min(node.min[a], p.min[a]);
+					node.max[a] = std::max(node.max[a], p.max[a]);
+					centerMin[a] = std::min(centerMin[a], p.center[a]);
+					centerMax[a] = std::max(centerMax[a], p.center[a]);
+				}
+			}
+
+			const size_t nodeIndex = output.size();
+			const size_t split = findSplit(primitives, indices, begin, end, depth, node, centerMin, centerMax);
+			if (split == end)
+			{
+				node.offset = static_cast<uint32_t>(begin);
+				node.count = static_cast<uint32_t>(end - begin);
+				output.push_back(node);
+				return;
+			}
+
+			node.count = 0;
+			output.push_back(node);
+			if (parallelDepth > 0 && end - begin >= PARALLEL_BUILD_LIMIT)
+			{
+				// Both halves work on disjoint parts of the index array, the right nodes are appended afterwards
+				std::vector<Node> rightNodes;
+				auto future = std::async(std::launch::async, [&]()
+				{
+					buildNode(primitives, indices, split, end, depth + 1, parallelDepth - 1, rightNodes);
+				});
+				buildNode(primitives, indices, begin, split, depth + 1, parallelDepth - 1, output);
+				future.get();
+				const uint32_t base = static_cast<uint32_t>(output.size());
+				output[nodeIndex].offset = base;
+				for (Node n : rightNodes)
+				{
+					if (n.count == 0)
+						n.offset += base;
+					output.push_back(n);
+				}
+			}
+			else
+			{
+				buildNode(primitives, indices, begin, split, depth + 1, 0, output);
+				output[nodeIndex].offset = static_cast<uint32_t>(output.size());
+				buildNode(primitives, indices, split, end, depth + 1, 0, output);
+			}
+		}
+
+		static inline float halfArea(const float min[3], const float max[3])
+		{
+			float d[3] = { max[0] - min[0], max[1] - min[1], max[2] - min[2] };
+			return d[0] * d[1] + d[1] * d[2] + d[2] * d[0];
+		}
+
+		// Returns the split position inside the range or end if a leaf node should be created
+		static size_t findSplit(const std::vector<Primitive>& primitives, std::vector<uint32_t>& indices,
+			size_t begin, size_t end, size_t depth, const Node& node, const float centerMin[3], const float centerMax[3])
+		{
+			const size_t count = end - begin;
+			if (count <= 1)
+				return end;
+
+			auto medianSplit = [&]()
+			{
+				size_t axis = 0;
+				for (size_t a = 1; a < 3; a++)
+					if (centerMax[a] - centerMin[a] > centerMax[axis] - centerMin[axis])
+						axis = a;
+				size_t middle = begin + count / 2;
+				std::nth_element(indices.begin() + begin, indices.begin() + middle, indices.begin() + end,
+					[&](uint32_t i1, uint32_t i2) { return primitives[i1].center[axis] < primitives[i2].center[axis]; });
+				return middle;
+			};
+			if (depth >= MAX_SAH_DEPTH)
+				return count <= MAX_LEAF_SIZE ? end : medianSplit();
+
+			struct Bin { float min[3]; float max[3]; size_t count; };
+			auto clearBin = [](Bin& bin)
+			{
+				for (size_t a = 0; a < 3; a++)
+				{
+					bin.min[a] = INFINITY;
+					bin.max[a] = -INFINITY;
+				}
+				bin.count = 0;
+			};
+			auto growBin = [](Bin& bin, const float min[3], const float max[3], size_t count)
+			{
+				for (size_t a = 0; a < 3; a++)
+				{
+					bin.min[a] = std::min(bin.min[a], min[a]);
+					bin.max[a] = std::max(bin.max[a], max[a]);
+				}
+				bin.count += count;
+			};
+			auto binIndex = [&](const Primitive& p, size_t axis)
+			{
+				float scale = BIN_COUNT / (centerMax[axis] - centerMin[axis]);
+				return std::min(BIN_COUNT - 1, static_cast<size_t>((p.center[axis] - centerMin[axis]) * scale));
+			};
+
+			float bestCost = INFINITY;
+			size_t bestAxis = 3, bestBin = 0;
+			for (size_t axis = 0; axis < 3; axis++)
+			{
+				if (!(centerMax[axis] - centerMin[axis] > 0))
+					continue;
+
+				Bin bins[BIN_COUNT];
+				for (auto& bin : bins)
+					clearBin(bin);
+				for (size_t i = begin; i < end; i++)
+				{
+					const auto& p = primitives[indices[i]];
+					growBin(bins[binIndex(p, axis)], p.min, p.max, 1);
+				}
+
+				float rightArea[BIN_COUNT];
+				size_t rightCount[BIN_COUNT];
+				Bin accumulated;
+				clearBin(accumulated);
+				for (size_t b = BIN_COUNT - 1; b > 0; b--)
+				{
+					growBin(accumulated, bins[b].min, bins[b].max, bins[b].count);
+					rightArea[b] = accumulated.count > 0 ? halfArea(accumulated.min, accumulated.max) : 0;
+					rightCount[b] = accumulated.count;
+				}
+
+				clearBin(accumulated);
+				for (size_t b = 0; b < BIN_COUNT - 1; b++)
+				{
+					growBin(accumulated, bins[b].min, bins[b].max, bins[b].count);
+					if (accumulated.count == 0 || rightCount[b + 1] == 0)
+						continue;
+					float cost = accumulated.count * halfArea(accumulated.min, accumulated.max) + rightCount[b + 1] * rightArea[b + 1];
+					if (cost < bestCost)
+					{
+						bestCost = cost;
+						bestAxis = axis;
+						bestBin = b + 1;
+					}
+				}
+			}
+
+			// All centers are identical and the binning cannot separate them
+			if (bestAxis == 3)
+				return count <= MAX_LEAF_SIZE ? end : medianSplit();
+
+			// Compare with the cost of a leaf, assuming a traversal step is as expensive as a triangle test
+			const float nodeArea = halfArea(node.min, node.max);
+			if (count <= MAX_LEAF_SIZE && nodeArea + bestCost >= count * nodeArea)
+				return end;
+
+			auto middle = std::partition(indices.begin() + begin, indices.begin() + end,
+				[&](uint32_t i) { return binIndex(primitives[i], bestAxis) < bestBin; });
+			return static_cast<size_t>(middle - indices.begin());
+		}
+
+		static inline bool rayBoxTest(const Node& node, const float o[3], const float inv[3], float tMax, float& tEntry)
+		{
+			float t0 = 0, t1 = tMax;
+			for (size_t a = 0; a < 3; a++)
+			{
+				float tNear = (node.min[a] - o[a]) * inv[a];
+				float tFar = (node.max[a] - o[a]) * inv[a];
+				if (tNear > tFar)
+					std::swap(tNear, tFar);
+				t0 = std::max(t0, tNear);
+				t1 = std::min(t1, tFar);
+			}
+			tEntry = t0;
+			return t0 <= t1;
+		}
+
+		// Moeller-Trumbore ray triangle intersection
+		static inline bool rayTriangleTest(const std::array<float, 9>& tri, const float o[3], const float d[3], float& t, float& u, float& v)
+		{
+			const float e1[3] = { tri[3] - tri[0], tri[4] - tri[1], tri[5] - tri[2] };
+			const float e2[3] = { tri[6] - tri[0], tri[7] - tri[1], tri[8] - tri[2] };
+			const float p[3] = { d[1] * e2[2] - d[2] * e2[1], d[2] * e2[0] - d[0] * e2[2], d[0] * e2[1] - d[1] * e2[0] };
+			const float det = e1[0] * p[0] + e1[1] * p[1] + e1[2] * p[2];
+			if (det == 0)
+				return false;
+			const float invDet = 1.0f / det;
+			const float s[3] = { o[0] - tri[0], o[1] - tri[1], o[2] - tri[2] };
+			u = (s[0] * p[0] + s[1] * p[1] + s[2] * p[2]) * invDet;
+			if (u < 0 || u > 1)
+				return false;
+			const float q[3] = { s[1] * e1[2] - s[2] * e1[1], s[2] * e1[0] - s[0] * e1[2], s[0] * e1[1] - s[1] * e1[0] };
+			v = (d[0] * q[0] + d[1] * q[1] + d[2] * q[2]) * invDet;
+			if (v < 0 || u + v > 1)
+				return false;
+			t = (e2[0] * q[0] + e2[1] * q[1] + e2[2] * q[2]) * invDet;
+			return t > 0;
+		}
+
+		static inline float boxDistanceSquared(const Node& node, const float p[3])
+		{
+			float distance = 0;
+			for (size_t a = 0; a < 3; a++)
+			{
+				float d = std::max(std::max(node.min[a] - p[a], p[a] - node.max[a]), 0.0f);
+				distance += d * d;
+			}
+			return distance;
+		}
+
+		// Closest point on triangle, see Ericson: Real-Time Collision Detection, chapter 5.1.5
+		static void closestPointOnTriangle(const std::array<float, 9>& tri, const float p[3], float c[3])
+		{
+			auto dot = [](const float x[3], const float y[3]) { return x[0] * y[0] + x[1] * y[1] + x[2] * y[2]; };
+			const float* a = tri.data();
+			const float* b = tri.data() + 3;
+			const float* cc = tri.data() + 6;
+			auto combine = [&](const float* base, const float* target, float w)
+			{
+				for (size_t i = 0; i < 3; i++)
+					c[i] = base[i] + w * (target[i] - base[i]);
+			};
+
+			const float ab[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+			const float ac[3] = { cc[0] - a[0], cc[1] - a[1], cc[2] - a[2] };
+			const float ap[3] = { p[0] - a[0], p[1] - a[1], p[2] - a[2] };
+			const float d1 = dot(ab, ap), d2 = dot(ac, ap);
+			if (d1 <= 0 && d2 <= 0)
+				return combine(a, a, 0);
+
+			const float bp[3] = { p[0] - b[0], p[1] - b[1], p[2] - b[2] };
+			const float d3 = dot(ab, bp), d4 = dot(ac, bp);
+			if (d3 >= 0 && d4 <= d3)
+				return combine(b, b, 0);
+
+			const float vc = d1 * d4 - d3 * d2;
+			if (vc <= 0 && d1 >= 0 && d3 <= 0)
+				return combine(a, b, d1 / (d1 - d3));
+
+			const float cp[3] = { p[0] - cc[0], p[1] - cc[1], p[2] - cc[2] };
+			const float d5 = dot(ab, cp), d6 = dot(ac, cp);
+			if (d6 >= 0 && d5 <= d6)
+				return combine(cc, cc, 0);
+
+			const float vb = d5 * d2 - d1 * d6;
+			if (vb <= 0 && d2 >= 0 && d6 <= 0)
+				return combine(a, cc, d2 / (d2 - d6));
+
+			const float va = d3 * d6 - d5 * d4;
+			if (va <= 0 && (d4 - d3) >= 0 && (d5 - d6) >= 0)
+				return combine(b, cc, (d4 - d3) / ((d4 - d3) + (d5 - d6)));
+
+			const float denom = 1.0f / (va + vb + vc);
+			const float v = vb * denom, w = vc * denom;
+			for (size_t i = 0; i < 3; i++)
+				c[i] = a[i] + ab[i] * v + ac[i] * w;
+		}
+
+		// Separating axis test for triangle and box, see Akenine-Moeller: Fast 3D Triangle-Box Overlap Testing
+		static bool triangleBoxTest(const std::array<float, 9>& tri, const float center[3], const float half[3])
+		{
+			float v[3][3];
+			for (size_t i = 0; i < 3; i++)
+				for (size_t a = 0; a < 3; a++)
+					v[i][a] = tri[i * 3 + a] - center[a];
+
+			// Box face normals
+			for (size_t a = 0; a < 3; a++)
+			{
+				float min = std::min(std::min(v[0][a], v[1][a]), v[2][a]);
+				float max = std::max(std::max(v[0][a], v[1][a]), v[2][a]);
+				if (min > half[a] || max < -half[a])
+					return false;
+			}
+
+			// Triangle edges crossed with the box axes
+			const float e[3][3] = {
+				{ v[1][0] - v[0][0], v[1][1] - v[0][1], v[1][2] - v[0][2] },
+				{ v[2][0] - v[1][0], v[2][1] - v[1][1], v[2][2] - v[1][2] },
+				{ v[0][0] - v[2][0], v[0][1] - v[2][1], v[0][2] - v[2][2] },
+			};
+			for (size_t i = 0; i < 3; i++)
+			{
+				for (size_t a = 0; a < 3; a++)
+				{
+					float axis[3] = { 0, 0, 0 };
+					size_t a1 = (a + 1) % 3, a2 = (a + 2) % 3;
+					axis[a1] = -e[i][a2];
+					axis[a2] = e[i][a1];
+					float p0 = axis[0] * v[0][0] + axis[1] * v[0][1] + axis[2] * v[0][2];
+					float p1 = axis[0] * v[1][0] + axis[1] * v[1][1] + axis[2] * v[1][2];
+					float p2 = axis[0] * v[2][0] + axis[1] * v[2][1] + axis[2] * v[2][2];
+					float r = half[0] * fabs(axis[0]) + half[1] * fabs(axis[1]) + half[2] * fabs(axis[2]);
+					if (std::min(std::min(p0, p1), p2) > r || std::max(std::max(p0, p1), p2) < -r)
+						return false;
+				}
+			}
+
+			// Triangle plane
+			const float n[3] = {
+				e[0][1] * e[1][2] - e[0][2] * e[1][1],
+				e[0][2] * e[1][0] - e[0][0] * e[1][2],
+				e[0][0] * e[1][1] - e[0][1] * e[1][0],
+			};
+			float distance = n[0] * v[0][0] + n[1] * v[0][1] + n[2] * v[0][2];
+			float r = half[0] * fabs(n[0]) + half[1] * fabs(n[1]) + half[2] * fabs(n[2]);
+			return fabs(distance) <= r;
+		}
+	};
+
+	// Fast non-cryptographic 64 bit hash that can be used for checksums and cache keys
+	uint64_t hashBytes(const void* data, size_t size, uint64_t seed = 0)
+	{
+		const uint64_t prime = 0x9E3779B97F4A7C15ull;
+		auto mix = [](uint64_t x)
+		{
+			x ^= x >> 32;
+			x *= 0xD6E8FEB86659FD93ull;
+			x ^= x >> 32;
+			x *= 0xD6E8FEB86659FD93ull;
+			x ^= x >> 32;
+			return x;
+		};
+
+		// Four independent lanes to keep the multipliers busy
+		const uint8_t* bytes = static_cast<const uint8_t*>(data);
+		uint64_t lanes[4] = { seed + prime, seed ^ prime, seed - prime, ~seed };
+		size_t offset = 0;
+		for (; offset + 32 <= size; offset += 32)
+		{
+			for (size_t l = 0; l < 4; l++)
+			{
+				uint64_t word;
+				memcpy(&word, bytes + offset + l * 8, 8);
+				lanes[l] = (lanes[l] ^ mix(word)) * prime;
+			}
+		}
+
+		uint64_t hash = mix(size ^ seed);
+		for (size_t l = 0; l < 4; l++)
+			hash = (hash ^ mix(lanes[l])) * prime;
+		for (; offset + 8 <= size; offset += 8)
+		{
+			uint64_t word;
+			memcpy(&word, bytes + offset, 8);
+			hash = (hash ^ mix(word)) * prime;
+		}
+		if (offset < size)
+		{
+			uint64_t word = 0;
+			memcpy(&word, bytes + offset, size - offset);
+			hash = (hash ^ mix(word)) * prime;
+		}
+		return mix(hash);
+	}
+
+	// Geometric fingerprint of STL content that does not depend on the facet order, the vertex rotation
+	// within the facets or the file format. Each facet is hashed in a canonical form that starts with its
+	// smallest vertex, the facet hashes are combined with commutative sums. Normals are ignored by default
+	// because they are often recalculated or rounded differently by exporters.
+	// All values are rounded to a number of significant decimal digits before hashing, so the rounding of an
+	// ASCII export does not change the fingerprint. Negative zero is treated like positive zero.
+	class Fingerprint
+	{
+	public:
+		// Zero keeps the exact values, more than nine digits are exact for floats anyway
+		explicit Fingerprint(bool includeNormals = false, int significantDigits = DEFAULT_SIGNIFICANT_DIGITS)
+			: normals(includeNormals), digits(std::clamp(significantDigits, 0, 9)) {}
+
+		// Same precision as the ASCII output of the writer
+		static inline const int DEFAULT_SIGNIFICANT_DIGITS = 6;
+
+		void addFacet(const float v1[3], const float v2[3], const float v3[3], const float n[3])
+		{
+			uint32_t words[12];
+			const float* corners[3] = { v1, v2, v3 };
+			// Rotate the facet to start with its smallest vertex while keeping the orientation
+			size_t first = 0;
+			uint32_t bits[3][3];
+			for (size_t c = 0; c < 3; c++)
+				for (size_t k = 0; k < 3; k++)
+					bits[c][k] = floatBits(quantize(corners[c][k]));
+			for (size_t c = 1; c < 3; c++)
+				if (std::lexicographical_compare(bits[c], bits[c] + 3, bits[first], bits[first] + 3))
+					first = c;
+			for (size_t c = 0; c < 3; c++)
+				for (size_t k = 0; k < 3; k++)
+					words[3 * c + k] = bits[(first + c) % 3][k];
+			size_t wordCount = 9;
+			if (normals)
+			{
+				for (size_t k = 0; k < 3; k++)
+					words[wordCount++] = floatBits(quantize(n[k]));
+			}
+			uint64_t hash = hashBytes(words, wordCount * sizeof(uint32_t));
+			facetCount++;
+			sum += hash;
+			mixedSum += mix(hash ^ 0xA0761D6478BD642Full);
+		}
+
+		// Add all facets of another fingerprint, e.g. one computed for another part of the mesh with the same settings
+		void merge(const Fingerprint& other)
+		{
+			facetCount += other.facetCount;
+			sum += other.sum;
+			mixedSum += other.mixedSum;
+		}
+
+		void clear()
+		{
+			facetCount = sum = mixedSum = 0;
+		}
+
+		uint64_t getValue() const
+		{
+			const uint64_t values[5] = { facetCount, sum, mixedSum, normals ? 1u : 0u, static_cast<uint64_t>(digits) };
+			return hashBytes(values, sizeof(values));
+		}
+
+		uint64_t getFacetCount() const { return facetCount; }
+		bool includesNormals() const { return normals; }
+		int getSignificantDigits() const { return digits; }
+
+		bool operator==(const Fingerprint& other) const
+		{
+			return facetCount == other.facetCount && sum == other.sum && mixedSum == other.mixedSum &&
+				normals == other.normals && digits == other.digits;
+		}
+		bool operator!=(const Fingerprint& other) const { return !(*this == other); }
+
+	private:
+		static uint32_t floatBits(float f)
+		{
+			// Adding zero turns negative zero into positive zero
+			f += 0.0f;
+			uint32_t bits;
+			memcpy(&bits, &f, sizeof(bits));
+			return bits;
+		}
+
+		// Round to the significant digits, a value and its rounded decimal representation give the same result
+		float quantize(float value) const
+		{
+			if (digits == 0 || value == 0.0f || !std::isfinite(value))
+				return value;
+			double a = std::fabs(static_cast<double>(value));
+			int binaryExponent;
+			std::frexp(a, &binaryExponent);
+			int exponent = static_cast<int>(std::floor((binaryExponent - 1) * 0.30102999566398120));
+			while (powerOfTen(exponent) > a)
+				exponent--;
+			while (powerOfTen(exponent + 1) <= a)
+				exponent++;
+
+			// Ties are rounded to even like the formatted output of the standard library
+			int shift = digits - 1 - exponent;
+			if (shift >= 0)
+				return static_cast<float>(std::nearbyint(value * powerOfTen(shift)) / powerOfTen(shift));
+			return static_cast<float>(std::nearbyint(value / powerOfTen(-shift)) * powerOfTen(-shift));
+		}
+
+		static double powerOfTen(int exponent)
+		{
+			// Covers the decimal exponents of all finite floats and the shifts for up to nine digits
+			static const std::array<double, 128> powers = []()
+			{
+				std::array<double, 128> p;
+				for (int i = 0; i < 128; i++)
+					p[i] = std::pow(10.0, i - 64);
+				return p;
+			}();
+			return powers[exponent + 64];
+		}
+
+		static uint64_t mix(uint64_t x)
+		{
+			x ^= x >> 31;
+			x *= 0xBF58476D1CE4E5B9ull;
+			x ^= x >> 27;
+			x *= 0x94D049BB133111EBull;
+			x ^= x >> 31;
+			return x;
+		}
+
+		bool normals;
+		int digits;
+		uint64_t facetCount = 0;
+		uint64_t sum = 0;
+		uint64_t mixedSum = 0;
+	};
+
+	// Handler that computes the fingerprint while parsing. It can forward all calls to another handler,
+	// so duplicates can be detected without reading the file twice.
+	class FingerprintHandler : public Reader::ForwardingHandler
+	{
+	public:
+		Fingerprint fingerprint;
+
+		explicit FingerprintHandler(bool includeNormals = false, int significantDigits = Fingerprint::DEFAULT_SIGNIFICANT_DIGITS)
+			: ForwardingHandler(nullHandler()), fingerprint(includeNormals, significantDigits) {}
+		FingerprintHandler(Reader::Handler& targetHandler, bool includeNormals = false, int significantDigits = Fingerprint::DEFAULT_SIGNIFICANT_DIGITS)
+			: ForwardingHandler(targetHandler), fingerprint(includeNormals, significantDigits) {}
+
+		void onBegin(bool asciiMode) override
+		{
+			fingerprint.clear();
+			target.onBegin(asciiMode);
+		}
+
+		void onFacet(const float v1[3], const float v2[3], const float v3[3], const float n[3]) override
+		{
+			fingerprint.addFacet(v1, v2, v3, n);
+			target.onFacet(v1, v2, v3, n);
+		}
+
+	private:
+		struct NullHandler : Reader::Handler
+		{
+			void onFacet(const float v1[3], const float v2[3], const float v3[3], const float n[3]) override {}
+		};
+
+		static Reader::Handler& nullHandler()
+		{
+			static NullHandler handler;
+			return handler;
+		}
+	};
+
+	// Compute the fingerprint of a mesh on multiple threads
+	template<template<typename> class Allocator>
+	Fingerprint computeFingerprint(const BasicMesh<Allocator>& mesh, bool includeNormals = false, size_t threadCount = 0,
+		int significantDigits = Fingerprint::DEFAULT_SIGNIFICANT_DIGITS)
+	{
+		Fingerprint fingerprint(includeNormals, significantDigits);
+		std::mutex mutex;
+		parallelFor(mesh.facets.size(), threadCount, [&](size_t begin, size_t end)
+		{
+			Fingerprint partial(includeNormals, significantDigits);
+			for (size_t i = begin; i < end; i++)
+			{
+				const Facet& f = mesh.facets[i];
+				const float v1[3] = { f.v1.x, f.v1.y, f.v1.z };
+				const float v2[3] = { f.v2.x, f.v2.y, f.v2.z };
+				const float v3[3] = { f.v3.x, f.v3.y, f.v3.z };
+				const Normal normal = includeNormals ? getFacetNormal(mesh, i) : f.n;
+				const float n[3] = { normal.x, normal.y, normal.z };
+				partial.addFacet(v1, v2, v3, n);
+			}
+			std::lock_guard<std::mutex> lock(mutex);
+			fingerprint.merge(partial);
+		});
+		return fingerprint;
+	}
+
+	// Compute the fingerprint of a face-vertex mesh on multiple threads, equal to the fingerprint of the original mesh
+	template<template<typename> class Allocator>
+	Fingerprint computeFingerprint(const BasicFVMesh<Allocator>& mesh, bool includeNormals = false, size_t threadCount = 0,
+		int significantDigits = Fingerprint::DEFAULT_SIGNIFICANT_DIGITS)
+	{
+		Fingerprint fingerprint(includeNormals, significantDigits);
+		std::mutex mutex;
+		parallelFor(mesh.facets.size(), threadCount, [&](size_t begin, size_t end)
+		{
+			Fingerprint partial(includeNormals, significantDigits);
+			for (size_t i = begin; i < end; i++)
+			{
+				const FVFacet& f = mesh.facets[i];
+				const Vertex& a = mesh.vertices[f.v1];
+				const Vertex& b = mesh.vertices[f.v2];
+				const Vertex& c = mesh.vertices[f.v3];
+				const float v1[3] = { a.x, a.y, a.z };
+				const float v2[3] = { b.x, b.y, b.z };
+				const float v3[3] = { c.x, c.y, c.z };
+				const Normal normal = includeNormals ? getFacetNormal(mesh, i) : f.n;
+				const float n[3] = { normal.x, normal.y, normal.z };
+				partial.addFacet(v1, v2, v3, n);
+			}
+			std::lock_guard<std::mutex> lock(mutex);
+			fingerprint.merge(partial);
+		});
+		return fingerprint;
+	}
+
+	// Compact binary cache format for deduplicated face-vertex meshes.
+	// The vertex, index and normal arrays are stored aligned in the file so they can be used in place after memory mapping.
+	// On Windows the file is read into memory instead of being mapped.
+	class FVMeshCache
+	{
+	public:
+		FVMeshCache() {}
+		FVMeshCache(const FVMeshCache&) = delete;
+		FVMeshCache& operator=(const FVMeshCache&) = delete;
+		FVMeshCache(FVMeshCache&& other) noexcept { *this = std::move(other); }
+		~FVMeshCache() { close(); }
+
+		FVMeshCache& operator=(FVMeshCache&& other) noexcept
+		{
+			if (this != &other)
+			{
+				close();
+				std::swap(data, other.data);
+				std::swap(dataSize, other.dataSize);
+				std::swap(buffer, other.buffer);
+			}
+			return *this;
+		}
+
+		// Write a face-vertex mesh into a new cache file
+		template<template<typename> class Allocator>
+		static Result writeFile(const std::filesystem::path& filePath, const BasicFVMesh<Allocator>& mesh)
+		{
+			if (!isLittleEndian())
+				return Result::EndianError;
+			if (mesh.vertices.size() > std::numeric_limits<uint32_t>::max())
+				return Result::FacetCountError;
+
+			std::vector<uint32_t> indices(mesh.facets.size() * 3);
+			std::vector<Normal> normals(mesh.facets.size());
+			for (size_t i = 0; i < mesh.facets.size(); i++)
+			{
+				const auto& f = mesh.facets[i];
+				indices[i * 3 + 0] = static_cast<uint32_t>(f.v1);
+				indices[i * 3 + 1] = static_cast<uint32_t>(f.v2);
+				indices[i * 3 + 2] = static_cast<uint32_t>(f.v3);
+				normals[i] = getFacetNormal(mesh, i);
+			}
+
+			Header header{};
+			memcpy(header.magic, CACHE_MAGIC, sizeof(header.magic));
+			header.version = CACHE_VERSION;
+			header.headerSize = sizeof(Header);
+			header.vertexCount = mesh.vertices.size();
+			header.facetCount = mesh.facets.size();
+			header.verticesOffset = align(sizeof(Header));
+			header.indicesOffset = align(header.verticesOffset + mesh.vertices.size() * sizeof(Vertex));
+			header.normalsOffset = align(header.indicesOffset + indices.size() * sizeof(uint32_t));
+			header.fileSize = header.normalsOffset + normals.size() * sizeof(Normal);
+			header.checksum = calculateChecksum(mesh.vertices.data(), indices.data(), normals.data(), mesh.vertices.size(), mesh.facets.size());
+			for (size_t a = 0; a < 3; a++)
+			{
+				header.boundsMin[a] = mesh.vertices.empty() ? 0 : INFINITY;
+				header.boundsMax[a] = mesh.vertices.empty() ? 0 : -INFINITY;
+			}
+			for (const auto& v : mesh.vertices)
+			{
+				const float c[3] = { v.x, v.y, v.z };
+				for (size_t a = 0; a < 3; a++)
+				{
+					header.boundsMin[a] = std::min(header.boundsMin[a], c[a]);
+					header.boundsMax[a] = std::max(header.boundsMax[a], c[a]);
+				}
+			}
+
+			std::ofstream ofs(filePath, std::ios::binary);
+			if (!ofs)
+				return Result::FileError;
+			auto writeSection = [&ofs](uint64_t offset, const void* sectionData, size_t sectionSize)
+			{
+				const char padding[CACHE_ALIGNMENT] = { 0, };
+				uint64_t position = static_cast<uint64_t>(ofs.tellp());
+				ofs.write(padding, static_cast<std::streamsize>(offset - position));
+				ofs.write(static_cast<const char*>(sectionData), static_cast<std::streamsize>(sectionSize));
+			};
+			ofs.write(reinterpret_cast<const char*>(&header), sizeof(header));
+			writeSection(header.verticesOffset, mesh.vertices.data(), mesh.vertices.size() * sizeof(Vertex));
+			writeSection(header.indicesOffset, indices.data(), indices.size() * sizeof(uint32_t));
+			writeSection(header.normalsOffset, normals.data(), normals.size() * sizeof(Normal));
+			ofs.flush();
+			return ofs ? Result::Success : Result::FileError;
+		}
+
+		// Open a cache file and map its content. The layout and vertex indices are always checked,
+		// without checksum verification the vertex and normal data is used as it is.
+		Result open(const std::filesystem::path& filePath, bool verifyChecksum = false)
+		{
+			close();
+			if (!isLittleEndian())
+				return Result::EndianError;
+
+			Result result = mapFile(filePath);
+			if (result != Result::Success)
+				return result;
+			result = validate(verifyChecksum);
+			if (result != Result::Success)
+				close();
+			return result;
+		}
+
+		void close()
+		{
+#ifndef _WIN32
+			if (data != nullptr && buffer.empty())
+				munmap(const_cast<uint8_t*>(data), dataSize);
+#endif
+			buffer = std::vector<uint64_t>();
+			data = nullptr;
+			dataSize = 0;
+		}
+
+		bool isOpen() const { return data != nullptr; }
+		size_t getVertexCount() const { return isOpen() ? static_cast<size_t>(header().vertexCount) : 0; }
+		size_t getFacetCount() const { return isOpen() ? static_cast<size_t>(header().facetCount) : 0; }
+
+		// Direct access to the mapped arrays, the indices contain three vertex indices per facet
+		const Vertex* getVertices() const { return isOpen() ? reinterpret_cast<const Vertex*>(data + header().verticesOffset) : nullptr; }
+		const uint32_t* getIndices() const { return isOpen() ? reinterpret_cast<const uint32_t*>(data + header().indicesOffset) : nullptr; }
+		const Normal* getNormals() const { return isOpen() ? reinterpret_cast<const Normal*>(data + header().normalsOffset) : nullptr; }
+		Vertex getBoundsMin() const { return isOpen() ? Vertex{ header().boundsMin[0], header().boundsMin[1], header().boundsMin[2] } : Vertex{ 0, 0, 0 }; }
+		Vertex getBoundsMax() const { return isOpen() ? Vertex{ header().boundsMax[0], header().boundsMax[1], header().boundsMax[2] } : Vertex{ 0, 0, 0 }; }
+
+		// Copy the mapped data into a regular face-vertex mesh
+		template<template<typename> class Allocator = std::allocator>
+		BasicFVMesh<Allocator> toFVMesh(const typename BasicFVMesh<Allocator>::allocator_type& allocator = {}) const
+		{
+			BasicFVMesh<Allocator> mesh(allocator);
+			const Vertex* vertices = getVertices();
+			const uint32_t* indices = getIndices();
+			const Normal* normals = getNormals();
+			mesh.vertices.assign(vertices, vertices + getVertexCount());
+			mesh.facets.resize(getFacetCount());
+			for (size_t i = 0; i < mesh.facets.size(); i++)
+				mesh.facets[i] = FVFacet{ indices[i * 3 + 0], indices[i * 3 + 1], indices[i * 3 + 2], normals[i] };
+			return mesh;
+		}
+
+		static inline const char* CACHE_MAGIC = "MSTLFVMC";
+		static inline const uint32_t CACHE_VERSION = 1u;
+		static inline const size_t CACHE_ALIGNMENT = 64u;
+
+	private:
+		struct Header
+		{
+			char magic[8];
+			uint32_t version;
+			uint32_t headerSize;
+			uint64_t vertexCount;
+			uint64_t facetCount;
+			uint64_t verticesOffset;
+			uint64_t indicesOffset;
+			uint64_t normalsOffset;
+			uint64_t fileSize;
+			uint64_t checksum;
+			float boundsMin[3];
+			float boundsMax[3];
+		};
+		static_assert(sizeof(Header) == 96, "Cache header layout must not change!");
+		static_assert(sizeof(Vertex) == 12 && sizeof(Normal) == 12, "Vertices and normals must be tightly packed!");
+
+		const uint8_t* data = nullptr;
+		size_t dataSize = 0;
+		std::vector<uint64_t> buffer;
+
+		const Header& header() const { return *reinterpret_cast<const Header*>(data); }
+
+		static uint64_t align(uint64_t offset)
+		{
+			return (offset + CACHE_ALIGNMENT - 1) / CACHE_ALIGNMENT * CACHE_ALIGNMENT;
+		}
+
+		static bool isLittleEndian()
+		{
+			int16_t number = 1;
+			char* ptr = reinterpret_cast<char*>(&number);
+			return *ptr == 1;
+		}
+
+		static uint64_t calculateChecksum(const Vertex* vertices, const uint32_t* indices, const Normal* normals, size_t vertexCount, size_t facetCount)
+		{
+			uint64_t hashes[3] = {
+				hashBytes(vertices, vertexCount * sizeof(Vertex)),
+				hashBytes(indices, facetCount * 3 * sizeof(uint32_t)),
+				hashBytes(normals, facetCount * sizeof(Normal)),
+			};
+			return hashBytes(hashes, sizeof(hashes));
+		}
+
+		Result mapFile(const std::filesystem::path& filePath)
+		{
+#ifndef _WIN32
+			int fd = ::open(filePath.c_str(), O_RDONLY);
+			if (fd < 0)
+				return Result::FileError;
+			struct stat info;
+			if (fstat(fd, &info) != 0)
+			{
+				::close(fd);
+				return Result::FileError;
+			}
+			if (static_cast<size_t>(info.st_size) < sizeof(Header))
+			{
+				::close(fd);
+				return Result::CacheFormatError;
+			}
+			void* mapping = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+			::close(fd);
+			if (mapping == MAP_FAILED)
+				return Result::FileError;
+			data = static_cast<const uint8_t*>(mapping);
+			dataSize = static_cast<size_t>(info.st_size);
+			return Result::Success;
+#else
+			std::ifstream ifs(filePath, std::ios::binary | std::ios::ate);
+			if (!ifs)
+				return Result::FileError;
+			size_t size = static_cast<size_t>(ifs.tellg());
+			if (size < sizeof(Header))
+				return Result::CacheFormatError;
+			ifs.seekg(0, std::ios::beg);
+			buffer.resize((size + 7) / 8);
+			ifs.read(reinterpret_cast<char*>(buffer.data()), static_cast<std::streamsize>(size));
+			if (!ifs)
+			{
+				buffer = std::vector<uint64_t>();
+				return Result::FileError;
+			}
+			data = reinterpret_cast<const uint8_t*>(buffer.data());
+			dataSize = size;
+			return Result::Success;
+#endif
+		}
+
+		Result validate(bool verifyChecksum) const
+		{
+			const Header& h = header();
+			if (memcmp(h.magic, CACHE_MAGIC, sizeof(h.magic)) != 0 || h.version != CACHE_VERSION || h.headerSize != sizeof(Header))
+				return Result::CacheFormatError;
+			if (h.fileSize != dataSize || h.vertexCount > std::numeric_limits<uint32_t>::max() || h.facetCount > dataSize)
+				return Result::CacheFormatError;
+			if (h.verticesOffset % CACHE_ALIGNMENT != 0 || h.indicesOffset % CACHE_ALIGNMENT != 0 || h.normalsOffset % CACHE_ALIGNMENT != 0)
+				return Result::CacheFormatError;
+			// Compare sizes against the remaining space so that crafted offsets cannot wrap around
+			if (h.verticesOffset < sizeof(Header) || h.verticesOffset > h.indicesOffset ||
+				h.indicesOffset > h.normalsOffset || h.normalsOffset > h.fileSize)
+				return Result::CacheFormatError;
+			if (h.vertexCount * sizeof(Vertex) > h.indicesOffset - h.verticesOffset ||
+				h.facetCount * 3 * sizeof(uint32_t) > h.normalsOffset - h.indicesOffset ||
+				h.facetCount * sizeof(Normal) > h.fileSize - h.normalsOffset)
+				return Result::CacheFormatError;
+
+			if (verifyChecksum)
+			{
+				uint64_t checksum = calculateChecksum(getVertices(), getIndices(), getNormals(), getVertexCount(), getFacetCount());
+				if (checksum != h.checksum)
+					return Result::CacheFormatError;
+			}
+
+			// The index bounds are always checked since toFVMesh() and its users rely on them
+			const uint32_t* indices = getIndices();
+			for (size_t i = 0; i < getFacetCount() * 3; i++)
+				if (indices[i] >= h.vertexCount)
+					return Result::CacheFormatError;
+
+			return Result::Success;
+		}
+	};
+
+	// Opt-in on-disk cache in front of the reader that stores deduplicated meshes in the FVMeshCache format.
+	// Entries are keyed by path, size, modification time and content hash of the STL file.
+	// Multiple processes can share a cache directory since entries are only published with atomic renames.
+	// The least recently used entries are removed when the total size exceeds the configured limit.
+	class ConversionCache
+	{
+	public:
+		ConversionCache(const std::filesystem::path& cacheDirectory, uint64_t maxCacheSize = DEFAULT_MAX_SIZE)
+			: directory(cacheDirectory), maxSize(maxCacheSize) {}
+
+		// Set to false to skip hashing the STL file content and trust path, size and modification time alone
+		bool hashContent = true;
+
+		// Loads the deduplicated mesh of an STL file from the cache or reads, deduplicates and caches it.
+		// The mapped cache entry stays valid even if the entry is evicted later on by another process.
+		Result readStlFile(const std::filesystem::path& filePath, FVMeshCache& mapped, bool* cacheHit = nullptr)
+		{
+			FVMesh mesh;
+			return load(filePath, &mapped, mesh, cacheHit);
+		}
+
+		// Same as above but returns a regular face-vertex mesh.
+		// Failures to write the cache entry are ignored since the mesh is available anyway.
+		Result readStlFile(const std::filesystem::path& filePath, FVMesh& mesh, bool* cacheHit = nullptr)
+		{
+			return load(filePath, nullptr, mesh, cacheHit);
+		}
+
+		// Removes the least recently used entries until the cache size is below the limit
+		void evict()
+		{
+			struct Entry { std::filesystem::path path; std::filesystem::file_time_type time; uint64_t size; };
+			std::vector<Entry> entries;
+			uint64_t totalSize = 0;
+			std::error_code error;
+			for (const auto& item : std::filesystem::directory_iterator(directory, error))
+			{
+				if (item.path().extension() != ENTRY_EXTENSION)
+					continue;
+				std::error_code timeError, sizeError;
+				Entry entry{ item.path(), item.last_write_time(timeError), item.file_size(sizeError) };
+				if (timeError || sizeError)
+					continue;
+				totalSize += entry.size;
+				entries.push_back(entry);
+			}
+
+			std::sort(entries.begin(), entries.end(), [](const Entry& e1, const Entry& e2) { return e1.time < e2.time; });
+			for (const auto& entry : entries)
+			{
+				if (totalSize <= maxSize)
+					break;
+				if (std::filesystem::remove(entry.path, error))
+					totalSize -= entry.size;
+			}
+		}
+
+		// Removes all entries from the cache directory
+		void clear()
+		{
+			std::error_code error;
+			for (const auto& item : std::filesystem::directory_iterator(directory, error))
+				if (item.path().extension() == ENTRY_EXTENSION)
+					std::filesystem::remove(item.path(), error);
+		}
+
+		static inline const uint64_t DEFAULT_MAX_SIZE = 4ull << 30;
+		static inline const char* ENTRY_EXTENSION = ".fvm";
+
+	private:
+		std::filesystem::path directory;
+		uint64_t maxSize;
+
+		static std::string toHex(uint64_t value)
+		{
+			char buffer[17];
+			snprintf(buffer, sizeof(buffer), "%016llx", static_cast<unsigned long long>(value));
+			return buffer;
+		}
+
+		Result getEntryPath(const std::filesystem::path& filePath, std::filesystem::path& entryPath) const
+		{
+			std::error_code error;
+			auto absolutePath = std::filesystem::absolute(filePath, error).lexically_normal();
+			uint64_t size = std::filesystem::file_size(absolutePath, error);
+			if (error)
+				return Result::FileError;
+			auto time = std::filesystem::last_write_time(absolutePath, error);
+			if (error)
+				return Result::FileError;
+
+			std::string pathString = absolutePath.u8string();
+			uint64_t key[4] = { hashBytes(pathString.data(), pathString.size()), size, static_cast<uint64_t>(time.time_since_epoch().count()), 0 };
+			if (hashContent)
+			{
+				std::ifstream ifs(absolutePath, std::ios::binary);
+				if (!ifs)
+					return Result::FileError;
+				std::vector<char> buffer(1 << 20);
+				while (ifs)
+				{
+					ifs.read(buffer.data(), buffer.size());
+					key[3] = hashBytes(buffer.data(), static_cast<size_t>(ifs.gcount()), key[3]);
+				}
+			}
+
+			entryPath = directory / (toHex(hashBytes(key, sizeof(key))) + ENTRY_EXTENSION);
+			return Result::Success;
+		}
+
+		Result load(const std::filesystem::path& filePath, FVMeshCache* mapped, FVMesh& mesh, bool* cacheHit)
+		{
+			if (cacheHit != nullptr)
+				*cacheHit = false;
+
+			std::filesystem::path entryPath;
+			Result result = getEntryPath(filePath, entryPath);
+			if (result != Result::Success)
+				return result;
+
+			// Entries are verified since they might be corrupted or written by a misbehaving process,
+			// broken entries are removed and replaced by a fresh conversion
+			std::error_code error;
+			FVMeshCache entry;
+			result = entry.open(entryPath, true);
+			if (result == Result::CacheFormatError)
+				std::filesystem::remove(entryPath, error);
+			if (result == Result::Success)
+			{
+				// Touch the entry to keep track of the least recently used ones
+				std::filesystem::last_write_time(entryPath, std::filesystem::file_time_type::clock::now(), error);
+				if (cacheHit != nullptr)
+					*cacheHit = true;
+				if (mapped != nullptr)
+					*mapped = std::move(entry);
+				else
+					mesh = entry.toFVMesh();
+				return Result::Success;
+			}
+
+			FVMeshReaderHandler handler;
+			result = Reader::readStlFile(filePath, handler);
+			if (result != Result::Success)
+				return result;
+			mesh = std::move(handler.mesh);
+
+			// Write into a unique temporary file first and publish it with an atomic rename
+			std::filesystem::create_directories(directory, error);
+			std::mt19937_64 random(std::random_device{}() ^ std::hash<std::thread::id>()(std::this_thread::get_id()));
+			auto tempPath = entryPath;
+			tempPath += "." + toHex(random()) + ".tmp";
+			result = FVMeshCache::writeFile(tempPath, mesh);
+			if (result == Result::Success && mapped != nullptr)
+				result = mapped->open(tempPath);
+			if (result == Result::Success)
+				std::filesystem::rename(tempPath, entryPath, error);
+			if (result != Result::Success || error)
+				std::filesystem::remove(tempPath, error);
+			else
+				evict();
+
+			return mapped != nullptr ? result : Result::Success;
+		}
+	};
+
+	// Pull based reader that yields the facets of ASCII or binary STL data one by one on demand.
+	// Memory usage is constant and no more data is read as soon as no further facets are requested.
+	class FacetReader
+	{
+	public:
+		// Read STL file directly from disk
+		explicit FacetReader(const std::filesystem::path& filePath)
+		{
+			ownedStream = std::make_unique<std::ifstream>(filePath, std::ios::binary);
+			is = ownedStream.get();
+			if (!*is)
+				result = Result::FileError;
+		}
+
+		// Read STL data from a memory buffer, the buffer must outlive the reader
+		FacetReader(const char* buffer, size_t bufferSize)
+		{
+			ownedStream = std::make_unique<Reader::imstream>(buffer, bufferSize);
+			is = ownedStream.get();
+		}
+
+		// Read STL data from a std::istream source, the stream must outlive the reader
+		explicit FacetReader(std::istream& stream) : is(&stream) {}
+
+		FacetReader(const FacetReader&) = delete;
+		FacetReader& operator=(const FacetReader&) = delete;
+
+		// Settings, must be changed before the first facet is read
+		bool forceNormals = false;
+		bool disableNormals = false;
+
+		// Reads the next facet, returns false after the last facet or when an error occured
+		bool next(Facet& facet)
+		{
+			if (!started)
+				start();
+			if (result != Result::Undefined)
+				return false;
+
+			capture.hasFacet = false;
+			if (asciiMode)
+			{
+				while (!capture.hasFacet)
+				{
+					state.lineNumber++;
+					if (!Reader::readNextLine(*is, line))
+					{
+						if (*is)
+						{
+							capture.onError(state.lineNumber);
+							result = Result::LineLimitError;
+						}
+						else
+						{
+							result = Reader::finishAscii(state);
+						}
+						return false;
+					}
+					Result r = Reader::parseAsciiLine(state, line, capture);
+					if (r != Result::Undefined)
+					{
+						result = r;
+						return false;
+					}
+				}
+			}
+			else
+			{
+				if (facetsRead == facetCount)
+				{
+					result = Result::Success;
+					return false;
+				}
+				char buffer[50];
+				is->read(buffer, sizeof(buffer));
+				if (!*is)
+				{
+					result = Result::MissingDataError;
+					return false;
+				}
+				facetsRead++;
+				Reader::parseBinaryFacet(buffer, state.forceNewNormals, state.disableNewNormals, capture);
+			}
+
+			facet = capture.facet;
+			return true;
+		}
+
+		// Result::Undefined while reading, the final result after next() returned false
+		Result getResult() const { return result; }
+
+		// Information about the STL data, available after the first call to next()
+		bool isAscii() const { return asciiMode; }
+		const std::string& getName() const { return capture.name; }
+		const uint8_t* getHeader() const { return capture.header; }
+		uint32_t getFacetCount() const { return facetCount; }
+		size_t getErrorLineNumber() const { return capture.errorLineNumber; }
+
+		// Attributes of the last facet from binary STL data
+		const uint8_t* getAttributes() const { return capture.attributes; }
+
+		// Input iterator to consume the facets with range based for loops or algorithms
+		class Iterator
+		{
+		public:
+			using iterator_category = std::input_iterator_tag;
+			using value_type = Facet;
+			using difference_type = std::ptrdiff_t;
+			using pointer = const Facet*;
+			using reference = const Facet&;
+
+			// Keeps a copy of the facet before a postfix increment, so that *it++ works like for std::istream_iterator
+			struct Proxy
+			{
+				Facet facet;
+				reference operator*() const { return facet; }
+			};
+
+			Iterator() {}
+			explicit Iterator(FacetReader* r) : reader(r) { ++(*this); }
+			reference operator*() const { return facet; }
+			pointer operator->() const { return &facet; }
+			Iterator& operator++() { if (reader != nullptr && !reader->next(facet)) reader = nullptr; return *this; }
+			Proxy operator++(int) { Proxy proxy{ facet }; ++(*this); return proxy; }
+			bool operator==(const Iterator& other) const { return reader == other.reader; }
+			bool operator!=(const Iterator& other) const { return reader != other.reader; }
+
+		private:
+			FacetReader* reader = nullptr;
+			Facet facet{};
+		};
+
+		Iterator begin() { return Iterator(this); }
+		Iterator end() { return Iterator(); }
+
+	private:
+		struct Capture : Reader::Handler
+		{
+			Facet facet{};
+			bool hasFacet = false;
+			uint8_t attributes[2] = { 0, 0 };
+			uint8_t header[80] = { 0, };
+			std::string name;
+			size_t errorLineNumber = 0;
+
+			void onName(const std::string& n) override { name = n; }
+			void onBinaryHeader(const uint8_t h[80]) override { memcpy(header, h, 80); }
+			void onError(size_t l) override { errorLineNumber = l; }
+			void onFacetAttributes(const uint8_t a[2]) override { attributes[0] = a[0]; attributes[1] = a[1]; }
+
+			void onFacet(const float v1[3], const float v2[3], const float v3[3], const float n[3]) override
+			{
+				facet.v1 = { v1[0], v1[1], v1[2] };
+				facet.v2 = { v2[0], v2[1], v2[2] };
+				facet.v3 = { v3[0], v3[1], v3[2] };
+				facet.n = { n[0], n[1], n[2] };
+				attributes[0] = attributes[1] = 0;
+				hasFacet = true;
+			}
+		};
+
+		std::unique_ptr<std::istream> ownedStream;
+		std::unique_ptr<Reader::replaystream> replay;
+		std::istream* is = nullptr;
+		Result result = Result::Undefined;
+		bool started = false;
+		bool asciiMode = false;
+		Capture capture;
+		Reader::AsciiState state;
+		std::string line;
+		uint32_t facetCount = 0;
+		uint32_t facetsRead = 0;
+
+		void start()
+		{
+			started = true;
+			if (result != Result::Undefined)
+				return;
+
+			state.forceNewNormals = forceNormals;
+			state.disableNewNormals = disableNormals;
+			// Replay the sniffed start of the stream, so forward-only streams are supported
+			replay = std::make_unique<Reader::replaystream>(*is);
+			is = replay.get();
+			asciiMode = replay->asciiMode;
+			if (asciiMode)
+				return;
+
+			if (!Reader::isLittleEndian())
+			{
+				result = Result::EndianError;
+				return;
+			}
+			char buffer[80];
+			is->read(buffer, sizeof(buffer));
+			if (!*is)
+			{
+				result = Result::MissingDataError;
+				return;
+			}
+			capture.onBinaryHeader(reinterpret_cast<const uint8_t*>(buffer));
+			is->read(buffer, 4);
+			if (!*is)
+			{
+				result = Result::MissingDataError;
+				return;
+			}
+			Result r = Reader::parseBinaryFacetCount(buffer, facetCount);
+			if (r != Result::Undefined)
+				result = r;
+		}
+	};
 };
@@ -1,6 +1,11 @@
 ﻿#include <microstl.h>
 #include <random>
 
+#ifndef _WIN32
+#include <csignal>
+#include <sys/resource.h>
+#endif
+
 #define TEST_SCOPE(x)
 #define REQUIRE(x) {if (!(x)) throw std::runtime_error("Test assertion failed!"); }
 
@@ -576,6 +581,1818 @@ int main()
 		std::filesystem::remove("binary.stl");
 	}
 
+	{
+		TEST_SCOPE("Build BVH for sphere and run spatial queries");
+		microstl::MeshReaderHandler handler;
+		auto res = microstl::Reader::readStlFile(findTestFile("sphere_binary.stl"), handler);
+		REQUIRE(res == handler.result && res == microstl::Result::Success);
+		const auto& facets = handler.mesh.facets;
+		microstl::BVH bvh(handler.mesh, 4);
+		REQUIRE(bvh.getFacetCount() == facets.size());
+		REQUIRE(bvh.getNodeCount() > 1);
+		auto bounds = bvh.getBounds();
+		REQUIRE(fabs(bounds.min.x + 10) < 0.001f && fabs(bounds.max.x - 10) < 0.001f);
+
+		// Rays from the center must hit the sphere surface, rays outside pointing away must miss
+		std::mt19937 gen(42);
+		std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+		std::vector<microstl::BVH::Ray> rays;
+		for (size_t i = 0; i < 100; i++)
+			rays.push_back({ { 0, 0, 0 }, { dist(gen), dist(gen), dist(gen) } });
+		rays.push_back({ { 20, 0, 0 }, { 1, 0, 0 } });
+		rays.push_back({ { 20, 0, 0 }, { -1, 0, 0 }, 5 });
+		auto hits = bvh.intersectRays(rays, 4);
+		for (size_t i = 0; i < 100; i++)
+		{
+			microstl::BVH::RayHit hit;
+			REQUIRE(bvh.intersectRay(rays[i], hit));
+			REQUIRE(hits[i].hit && hits[i].facet == hit.facet && hits[i].distance == hit.distance);
+			const auto& d = rays[i].direction;
+			float length = hit.distance * sqrt(d.x * d.x + d.y * d.y + d.z * d.z);
+			REQUIRE(length > 9.5f && length <= 10.001f);
+			const auto& f = facets[hit.facet];
+			float p[3] = { d.x * hit.distance - f.v1.x, d.y * hit.distance - f.v1.y, d.z * hit.distance - f.v1.z };
+			REQUIRE(fabs(p[0] * f.n.x + p[1] * f.n.y + p[2] * f.n.z) < 0.001f);
+		}
+		REQUIRE(!hits[100].hit);
+		REQUIRE(!hits[101].hit);
+
+		// Closest points for points outside the sphere and exactly on a vertex
+		std::vector<microstl::Vertex> points;
+		for (size_t i = 0; i < 100; i++)
+		{
+			float p[3] = { dist(gen), dist(gen), dist(gen) };
+			float length = sqrt(p[0] * p[0] + p[1] * p[1] + p[2] * p[2]);
+			points.push_back({ p[0] * 20 / length, p[1] * 20 / length, p[2] * 20 / length });
+		}
+		auto pointHits = bvh.closestPoints(points, 4);
+		for (const auto& hit : pointHits)
+			REQUIRE(hit.hit && hit.distance >= 9.999f && hit.distance < 10.5f);
+		microstl::BVH::PointHit pointHit;
+		REQUIRE(bvh.closestPoint(facets[7].v2, pointHit));
+		REQUIRE(pointHit.distance < 0.0001f);
+		REQUIRE(!bvh.closestPoint({ 20, 0, 0 }, pointHit, 5));
+
+		// Box queries
+		std::vector<size_t> overlaps;
+		bvh.overlapBox({ { -20, -20, -20 }, { 20, 20, 20 } }, overlaps);
+		REQUIRE(overlaps.size() == facets.size());
+		bvh.overlapBox({ { -1, -1, -1 }, { 1, 1, 1 } }, overlaps);
+		REQUIRE(overlaps.empty());
+		auto boxResults = bvh.overlapBoxes({ { { 9, -1, -1 }, { 11, 1, 1 } } });
+		REQUIRE(!boxResults[0].empty() && boxResults[0].size() < facets.size());
+		for (size_t index : boxResults[0])
+			REQUIRE(facets[index].v1.x > 8 || facets[index].v2.x > 8 || facets[index].v3.x > 8);
+
+		// Same results for the face-vertex mesh
+		microstl::BVH fvBvh(microstl::deduplicateVertices(handler.mesh), 1);
+		REQUIRE(fvBvh.getFacetCount() == facets.size());
+		microstl::BVH::RayHit fvHit;
+		REQUIRE(fvBvh.intersectRay(rays[0], fvHit));
+		REQUIRE(fvHit.facet == hits[0].facet);
+
+		// Empty hierarchy
+		microstl::BVH empty;
+		REQUIRE(!empty.intersectRay(rays[0], fvHit));
+		REQUIRE(!empty.closestPoint({ 0, 0, 0 }, pointHit));
+	}
+
+	{
+		TEST_SCOPE("Write and map face-vertex mesh cache file");
+		microstl::MeshReaderHandler handler;
+		auto res = microstl::Reader::readStlFile(findTestFile("box_meshlab_ascii.stl"), handler);
+		REQUIRE(res == handler.result && res == microstl::Result::Success);
+		auto fvMesh = microstl::deduplicateVertices(handler.mesh);
+
+		std::filesystem::path path("cache.fvm");
+		res = microstl::FVMeshCache::writeFile(path, fvMesh);
+		REQUIRE(res == microstl::Result::Success);
+
+		microstl::FVMeshCache cache;
+		REQUIRE(!cache.isOpen());
+		REQUIRE(cache.open(path, true) == microstl::Result::Success);
+		REQUIRE(cache.isOpen());
+		REQUIRE(cache.getVertexCount() == 8);
+		REQUIRE(cache.getFacetCount() == 12);
+		REQUIRE(reinterpret_cast<uintptr_t>(cache.getVertices()) % 64 == 0);
+		REQUIRE(reinterpret_cast<uintptr_t>(cache.getIndices()) % 64 == 0);
+		REQUIRE(cache.getBoundsMin().x == 0 && cache.getBoundsMin().y == -20 && cache.getBoundsMin().z == 0);
+		REQUIRE(cache.getBoundsMax().x == 20 && cache.getBoundsMax().y == 0 && cache.getBoundsMax().z == 20);
+		for (size_t i = 0; i < 12; i++)
+		{
+			REQUIRE(cache.getIndices()[i * 3 + 1] == fvMesh.facets[i].v2);
+			REQUIRE(cache.getNormals()[i].z == fvMesh.facets[i].n.z);
+		}
+		auto loaded = cache.toFVMesh();
+		REQUIRE(loaded.vertices.size() == 8 && loaded.facets.size() == 12);
+		REQUIRE(loaded.vertices[5].x == fvMesh.vertices[5].x && loaded.facets[11].v3 == fvMesh.facets[11].v3);
+
+		microstl::FVMeshCache moved(std::move(cache));
+		REQUIRE(moved.isOpen() && !cache.isOpen());
+		moved.close();
+		REQUIRE(!moved.isOpen());
+
+		// Corrupt the last normal and check the verification
+		{
+			std::fstream fs(path, std::ios::binary | std::ios::in | std::ios::out);
+			fs.seekp(-1, std::ios::end);
+			fs.put(42);
+		}
+		REQUIRE(cache.open(path) == microstl::Result::Success);
+		REQUIRE(cache.open(path, true) == microstl::Result::CacheFormatError);
+		REQUIRE(!cache.isOpen());
+
+		// Out of range indices and wrapping offsets are rejected even without checksum verification
+		auto patchCache = [&](bool patchIndex, const void* value, size_t size) {
+			REQUIRE(microstl::FVMeshCache::writeFile(path, fvMesh) == microstl::Result::Success);
+			std::fstream fs(path, std::ios::binary | std::ios::in | std::ios::out);
+			uint64_t offset = 48;
+			if (patchIndex)
+			{
+				fs.seekg(40);
+				fs.read(reinterpret_cast<char*>(&offset), sizeof(offset));
+			}
+			fs.seekp(static_cast<std::streamoff>(offset));
+			fs.write(reinterpret_cast<const char*>(value), static_cast<std::streamsize>(size));
+		};
+		uint32_t badIndex = 8;
+		patchCache(true, &badIndex, sizeof(badIndex));
+		REQUIRE(cache.open(path) == microstl::Result::CacheFormatError);
+		uint64_t badOffset = 0xFFFFFFFFFFFFFFC0ull;
+		patchCache(false, &badOffset, sizeof(badOffset));
+		REQUIRE(cache.open(path) == microstl::Result::CacheFormatError);
+		REQUIRE(!cache.isOpen());
+		std::filesystem::remove(path);
+
+		REQUIRE(cache.open(path) == microstl::Result::FileError);
+		REQUIRE(cache.open(findTestFile("box_freecad_binary.stl")) == microstl::Result::CacheFormatError);
+	}
+
+	{
+		TEST_SCOPE("Load STL files through the persistent conversion cache");
+		std::filesystem::path cacheDir("conversion_cache");
+		std::filesystem::path stlPath("cached.stl");
+		std::filesystem::remove_all(cacheDir);
+		std::filesystem::copy_file(findTestFile("box_meshlab_ascii.stl"), stlPath, std::filesystem::copy_options::overwrite_existing);
+
+		microstl::ConversionCache cache(cacheDir);
+		microstl::FVMesh mesh;
+		bool hit = true;
+		auto res = cache.readStlFile(stlPath, mesh, &hit);
+		REQUIRE(res == microstl::Result::Success && !hit);
+		REQUIRE(mesh.vertices.size() == 8 && mesh.facets.size() == 12);
+
+		microstl::FVMeshCache mapped;
+		res = cache.readStlFile(stlPath, mapped, &hit);
+		REQUIRE(res == microstl::Result::Success && hit);
+		REQUIRE(mapped.getVertexCount() == 8 && mapped.getFacetCount() == 12);
+		REQUIRE(mapped.getIndices()[35] == mesh.facets[11].v3);
+		mapped.close();
+
+		// Corrupted entries are discarded and replaced by a fresh conversion
+		for (const auto& item : std::filesystem::directory_iterator(cacheDir))
+		{
+			std::fstream fs(item.path(), std::ios::binary | std::ios::in | std::ios::out);
+			fs.seekp(-1, std::ios::end);
+			fs.put(42);
+		}
+		res = cache.readStlFile(stlPath, mesh, &hit);
+		REQUIRE(res == microstl::Result::Success && !hit);
+		REQUIRE(mesh.vertices.size() == 8 && mesh.facets.size() == 12);
+		res = cache.readStlFile(stlPath, mapped, &hit);
+		REQUIRE(res == microstl::Result::Success && hit);
+
+		// Changed content must not be served from the old entry
+		std::filesystem::copy_file(findTestFile("box_freecad_binary.stl"), stlPath, std::filesystem::copy_options::overwrite_existing);
+		res = cache.readStlFile(stlPath, mapped, &hit);
+		REQUIRE(res == microstl::Result::Success && !hit);
+		REQUIRE(mapped.getFacetCount() == 12);
+		mapped.close();
+
+		// Tiny limit will evict everything, but the loaded mesh is still returned
+		microstl::ConversionCache tinyCache(cacheDir, 1);
+		tinyCache.evict();
+		REQUIRE(std::filesystem::is_empty(cacheDir));
+		res = tinyCache.readStlFile(stlPath, mapped, &hit);
+		REQUIRE(res == microstl::Result::Success && !hit);
+		REQUIRE(mapped.getFacetCount() == 12);
+		REQUIRE(std::filesystem::is_empty(cacheDir));
+
+		// Errors of the reader are passed through
+		res = cache.readStlFile(findTestFile("incomplete_binary.stl"), mesh, &hit);
+		REQUIRE(res == microstl::Result::MissingDataError && !hit);
+		res = cache.readStlFile("does_not_exist.stl", mesh, &hit);
+		REQUIRE(res == microstl::Result::FileError);
+
+		cache.clear();
+		mapped.close();
+		std::filesystem::remove_all(cacheDir);
+		std::filesystem::remove(stlPath);
+	}
+
+	{
+		TEST_SCOPE("Read multiple STL files concurrently");
+		std::vector<std::filesystem::path> paths = {
+			findTestFile("simple_ascii.stl"),
+			findTestFile("stencil_binary.stl"),
+			findTestFile("incomplete_vertex_ascii.stl"),
+			"does_not_exist.stl",
+			findTestFile("half_donut_ascii.stl"),
+			findTestFile("sphere_binary.stl"),
+		};
+		std::atomic<size_t> factoryCalls(0);
+		auto factory = [&](const std::filesystem::path&)
+		{
+			factoryCalls++;
+			return std::make_unique<microstl::MeshReaderHandler>();
+		};
+		auto results = microstl::Reader::readStlFiles(paths, factory, 3);
+		REQUIRE(results.size() == paths.size());
+		REQUIRE(factoryCalls == paths.size());
+		const size_t expectedFacets[] = { 1, 2330, 0, 0, 288, 1360 };
+		for (size_t i = 0; i < paths.size(); i++)
+		{
+			const auto& meshHandler = static_cast<const microstl::MeshReaderHandler&>(*results[i].handler);
+			REQUIRE(results[i].path == paths[i]);
+			REQUIRE(results[i].result == meshHandler.result);
+			REQUIRE(meshHandler.mesh.facets.size() == expectedFacets[i]);
+		}
+		REQUIRE(results[0].result == microstl::Result::Success);
+		REQUIRE(results[2].result == microstl::Result::ParserError);
+		REQUIRE(results[2].errorLineNumber == 6);
+		REQUIRE(results[3].result == microstl::Result::FileError);
+		REQUIRE(microstl::Reader::readStlFiles({}, factory).empty());
+
+		bool exception = false;
+		auto nullFactory = [](const std::filesystem::path&) { return std::unique_ptr<microstl::Reader::Handler>(); };
+		try { microstl::Reader::readStlFiles(paths, nullFactory, 2); }
+		catch (const std::runtime_error&) { exception = true; }
+		REQUIRE(exception);
+	}
+
+	{
+		TEST_SCOPE("Read and deduplicate mesh with a monotonic arena");
+		std::array<uint8_t, 1 << 16> storage;
+		std::pmr::monotonic_buffer_resource arena(storage.data(), storage.size(), std::pmr::null_memory_resource());
+		microstl::pmr::MeshReaderHandler handler(&arena);
+		auto res = microstl::Reader::readStlFile(findTestFile("box_meshlab_ascii.stl"), handler);
+		REQUIRE(res == handler.result && res == microstl::Result::Success);
+		REQUIRE(handler.name == "STL generated by MeshLab");
+		REQUIRE(handler.mesh.facets.size() == 12);
+		REQUIRE(handler.mesh.facets.get_allocator().resource() == &arena);
+		auto fvMesh = microstl::deduplicateVertices(handler.mesh, &arena);
+		REQUIRE(fvMesh.vertices.size() == 8);
+		REQUIRE(fvMesh.vertices.get_allocator().resource() == &arena);
+		REQUIRE(fvMesh.facets.get_allocator().resource() == &arena);
+
+		// Copies use the default resource again
+		microstl::pmr::Mesh copy = handler.mesh;
+		REQUIRE(copy.facets.get_allocator().resource() == std::pmr::get_default_resource());
+		REQUIRE(copy.facets.size() == 12);
+
+		// Arena meshes work with the other mesh functions
+		auto decimated = microstl::decimateMesh(fvMesh, microstl::DecimationSettings(), &arena);
+		REQUIRE(decimated.vertices.get_allocator().resource() == &arena);
+		REQUIRE(microstl::computeFingerprint(fvMesh) == microstl::computeFingerprint(handler.mesh));
+	}
+
+	{
+		TEST_SCOPE("Default mesh and handler types use the standard containers");
+		microstl::MeshReaderHandler handler;
+		auto res = microstl::Reader::readStlFile(findTestFile("box_meshlab_ascii.stl"), handler);
+		REQUIRE(res == microstl::Result::Success);
+		std::string name = handler.name;
+		std::vector<microstl::Facet>& facets = handler.mesh.facets;
+		std::vector<uint8_t> header = handler.header;
+		std::vector<microstl::Vertex> vertices = microstl::deduplicateVertices(handler.mesh).vertices;
+		REQUIRE(name == "STL generated by MeshLab");
+		REQUIRE(facets.size() == 12 && header.empty() && vertices.size() == 8);
+	}
+
+	{
+		TEST_SCOPE("Parse STL data in chunks with the streaming parser");
+		const std::vector<std::string> files = {
+			"simple_ascii.stl", "crazy_whitespace_ascii.stl", "half_donut_ascii.stl", "stencil_binary.stl",
+			"misleading_binary_header.stl", "box_freecad_binary.stl", "incomplete_binary.stl", "empty_file.stl",
+			"exceed_ascii_line_limit.stl", "incomplete_vertex_ascii.stl", "incomplete_normal_ascii.stl"
+		};
+		for (const auto& file : files)
+		{
+			std::ifstream ifs(findTestFile(file), std::ios::binary);
+			std::vector<char> data((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+			microstl::MeshReaderHandler expected;
+			auto expectedResult = microstl::Reader::readStlBuffer(data.data(), data.size(), expected);
+
+			for (size_t chunkSize : { 1, 7, 50, 300, 100000 })
+			{
+				microstl::MeshReaderHandler handler;
+				microstl::Reader::StreamingParser parser(handler);
+				auto res = microstl::Result::Undefined;
+				for (size_t offset = 0; offset < data.size() && res == microstl::Result::Undefined; offset += chunkSize)
+					res = parser.feed(data.data() + offset, std::min(chunkSize, data.size() - offset));
+				if (res == microstl::Result::Undefined)
+					res = parser.finish();
+				REQUIRE(res == expectedResult && res == handler.result);
+				REQUIRE(parser.finish() == res);
+				REQUIRE(handler.ascii == expected.ascii);
+				REQUIRE(handler.name == expected.name);
+				REQUIRE(handler.header == expected.header);
+				REQUIRE(handler.errorLineNumber == expected.errorLineNumber);
+				REQUIRE(handler.mesh.facets.size() == expected.mesh.facets.size());
+				for (size_t i = 0; i < handler.mesh.facets.size(); i++)
+					REQUIRE(memcmp(&handler.mesh.facets[i], &expected.mesh.facets[i], sizeof(microstl::Facet)) == 0);
+			}
+		}
+	}
+
+	{
+		TEST_SCOPE("Pull facets lazily with the facet reader");
+		for (const auto& file : { "half_donut_ascii.stl", "stencil_binary.stl", "incomplete_binary.stl", "incomplete_vertex_ascii.stl" })
+		{
+			microstl::MeshReaderHandler expected;
+			auto expectedResult = microstl::Reader::readStlFile(findTestFile(file), expected);
+
+			microstl::FacetReader reader(findTestFile(file));
+			size_t index = 0;
+			for (const auto& facet : reader)
+			{
+				REQUIRE(index < expected.mesh.facets.size());
+				REQUIRE(memcmp(&facet, &expected.mesh.facets[index], sizeof(microstl::Facet)) == 0);
+				index++;
+			}
+			REQUIRE(index == expected.mesh.facets.size());
+			REQUIRE(reader.getResult() == expectedResult);
+			REQUIRE(reader.isAscii() == expected.ascii);
+			REQUIRE(reader.getName() == expected.name.c_str());
+			REQUIRE(reader.getErrorLineNumber() == expected.errorLineNumber);
+		}
+
+		// Stop early and zip two sources together
+		std::ifstream ifs(findTestFile("box_freecad_binary.stl"), std::ios::binary);
+		microstl::FacetReader binaryReader(ifs);
+		std::ifstream ifs2(findTestFile("box_meshlab_ascii.stl"), std::ios::binary);
+		std::string asciiData((std::istreambuf_iterator<char>(ifs2)), std::istreambuf_iterator<char>());
+		microstl::FacetReader asciiReader(asciiData.data(), asciiData.size());
+		microstl::Facet f1, f2;
+		size_t count = 0;
+		while (count < 5 && binaryReader.next(f1) && asciiReader.next(f2))
+		{
+			REQUIRE(f1.v1.x == f2.v1.x && f1.v2.y == f2.v2.y && f1.v3.z == f2.v3.z);
+			count++;
+		}
+		REQUIRE(count == 5);
+		REQUIRE(binaryReader.getResult() == microstl::Result::Undefined);
+		REQUIRE(binaryReader.getFacetCount() == 12);
+		REQUIRE(asciiReader.getName() == "STL generated by MeshLab");
+
+		// Range algorithms
+		microstl::FacetReader sphereReader(findTestFile("sphere_binary.stl"));
+		auto facetCount = std::distance(sphereReader.begin(), sphereReader.end());
+		REQUIRE(facetCount == 1360);
+		REQUIRE(sphereReader.getResult() == microstl::Result::Success);
+
+		// Postfix increment returns the facet before the increment
+		microstl::MeshReaderHandler boxHandler;
+		microstl::Reader::readStlFile(findTestFile("box_meshlab_ascii.stl"), boxHandler);
+		microstl::FacetReader postfixReader(findTestFile("box_meshlab_ascii.stl"));
+		auto it = postfixReader.begin();
+		microstl::Facet first = *it++;
+		microstl::Facet second = *it++;
+		REQUIRE(memcmp(&first, &boxHandler.mesh.facets[0], sizeof(microstl::Facet)) == 0);
+		REQUIRE(memcmp(&second, &boxHandler.mesh.facets[1], sizeof(microstl::Facet)) == 0);
+		REQUIRE(memcmp(&*it, &boxHandler.mesh.facets[2], sizeof(microstl::Facet)) == 0);
+
+		microstl::FacetReader missingReader("does_not_exist.stl");
+		REQUIRE(missingReader.begin() == missingReader.end());
+		REQUIRE(missingReader.getResult() == microstl::Result::FileError);
+	}
+
+	{
+		TEST_SCOPE("Read binary STL files in shards of facet ranges");
+		auto path = findTestFile("stencil_binary.stl");
+		microstl::MeshReaderHandler expected;
+		auto res = microstl::Reader::readStlFile(path, expected);
+		REQUIRE(res == microstl::Result::Success);
+
+		uint32_t facetCount = 0;
+		REQUIRE(microstl::Reader::readBinaryFacetCount(path, facetCount) == microstl::Result::Success);
+		REQUIRE(facetCount == 2330);
+
+		std::vector<microstl::Reader::FacetRange> shards;
+		REQUIRE(microstl::Reader::planBinaryShards(path, 7, shards) == microstl::Result::Success);
+		REQUIRE(shards.size() == 7);
+		std::vector<microstl::Facet> facets;
+		for (const auto& shard : shards)
+		{
+			REQUIRE(shard.count == 332 || shard.count == 333);
+			microstl::MeshReaderHandler handler;
+			res = microstl::Reader::readBinaryFacetRange(path, shard.first, shard.count, handler);
+			REQUIRE(res == handler.result && res == microstl::Result::Success);
+			REQUIRE(handler.mesh.facets.size() == shard.count);
+			REQUIRE(handler.header.size() == 80);
+			facets.insert(facets.end(), handler.mesh.facets.begin(), handler.mesh.facets.end());
+		}
+		REQUIRE(facets.size() == expected.mesh.facets.size());
+		REQUIRE(memcmp(facets.data(), expected.mesh.facets.data(), facets.size() * sizeof(microstl::Facet)) == 0);
+
+		// Ranges from buffers are clipped at the end
+		std::ifstream ifs(path, std::ios::binary);
+		std::vector<char> data((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+		microstl::MeshReaderHandler handler;
+		std::istringstream iss(std::string(data.begin(), data.end()));
+		res = microstl::Reader::readBinaryFacetRange(iss, 2320, 100, handler);
+		REQUIRE(res == microstl::Result::Success);
+		REQUIRE(handler.mesh.facets.size() == 10);
+		REQUIRE(memcmp(&handler.mesh.facets[9], &expected.mesh.facets[2329], sizeof(microstl::Facet)) == 0);
+
+		// Incomplete files and other errors
+		REQUIRE(microstl::Reader::readBinaryFacetCount(findTestFile("incomplete_binary.stl"), facetCount) == microstl::Result::MissingDataError);
+		res = microstl::Reader::readBinaryFacetRange(findTestFile("incomplete_binary.stl"), 3, 3, handler);
+		REQUIRE(res == microstl::Result::MissingDataError && handler.mesh.facets.size() == 2);
+		res = microstl::Reader::readBinaryFacetRange("does_not_exist.stl", 0, 1, handler);
+		REQUIRE(res == microstl::Result::FileError && handler.result == res);
+		REQUIRE(microstl::Reader::planBinaryShards(3, 5).size() == 3);
+		REQUIRE(microstl::Reader::planBinaryShards(100, 0).empty());
+	}
+
+	{
+		TEST_SCOPE("Detect the format on forward-only streams and by the total size");
+		// Stream buffer that delivers data in small pieces and does not support seeking, like a pipe
+		struct ForwardOnlyBuffer : std::streambuf
+		{
+			std::vector<char> data;
+			size_t position = 0;
+			void rewind() { position = 0; setg(nullptr, nullptr, nullptr); }
+			int_type underflow() override
+			{
+				if (position >= data.size())
+					return traits_type::eof();
+				size_t size = std::min<size_t>(13, data.size() - position);
+				setg(data.data() + position, data.data() + position, data.data() + position + size);
+				position += size;
+				return traits_type::to_int_type(*gptr());
+			}
+		};
+
+		const std::vector<std::string> files = {
+			"simple_ascii.stl", "crazy_whitespace_ascii.stl", "half_donut_ascii.stl", "stencil_binary.stl",
+			"misleading_binary_header.stl", "box_freecad_binary.stl", "incomplete_binary.stl", "empty_file.stl",
+			"incomplete_vertex_ascii.stl"
+		};
+		for (const auto& file : files)
+		{
+			microstl::MeshReaderHandler expected;
+			auto expectedResult = microstl::Reader::readStlFile(findTestFile(file), expected);
+
+			ForwardOnlyBuffer buffer;
+			std::ifstream ifs(findTestFile(file), std::ios::binary);
+			buffer.data.assign(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+			std::istream is(&buffer);
+			microstl::MeshReaderHandler handler;
+			auto res = microstl::Reader::readStlStream(is, handler);
+			REQUIRE(res == expectedResult && res == handler.result);
+			REQUIRE(handler.ascii == expected.ascii);
+			REQUIRE(handler.mesh.facets.size() == expected.mesh.facets.size());
+			for (size_t i = 0; i < handler.mesh.facets.size(); i++)
+				REQUIRE(memcmp(&handler.mesh.facets[i], &expected.mesh.facets[i], sizeof(microstl::Facet)) == 0);
+
+			buffer.rewind();
+			is.clear();
+			microstl::FacetReader reader(is);
+			size_t count = 0;
+			for (const auto& facet : reader)
+				REQUIRE(memcmp(&facet, &expected.mesh.facets[count++], sizeof(microstl::Facet)) == 0);
+			REQUIRE(count == expected.mesh.facets.size() && reader.getResult() == expectedResult);
+		}
+
+		// Binary header that fools the heuristic checks, only the known size reveals the binary format
+		std::ifstream ifs(findTestFile("box_freecad_binary.stl"), std::ios::binary);
+		std::vector<char> data((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+		const char fakeHeader[] = "solid fake\n facet normal 0 0 1\n";
+		memcpy(data.data(), fakeHeader, sizeof(fakeHeader));
+		microstl::MeshReaderHandler handler;
+		auto res = microstl::Reader::readStlBuffer(data.data(), data.size(), handler);
+		REQUIRE(res == microstl::Result::Success && !handler.ascii && handler.mesh.facets.size() == 12);
+		std::istringstream iss(std::string(data.begin(), data.end()));
+		res = microstl::Reader::readStlStream(iss, handler);
+		REQUIRE(res == microstl::Result::Success && !handler.ascii && handler.mesh.facets.size() == 12);
+		microstl::Reader::StreamingParser parser(handler, data.size());
+		res = parser.feed(data.data(), data.size());
+		REQUIRE(parser.finish() == res && res == microstl::Result::Success && !handler.ascii && handler.mesh.facets.size() == 12);
+		ForwardOnlyBuffer buffer;
+		buffer.data = data;
+		std::istream is(&buffer);
+		res = microstl::Reader::readStlStream(is, handler);
+		REQUIRE(res != microstl::Result::Success && handler.ascii);
+
+		// Data behind embedded binary STL data is not consumed and stays available in the stream
+		auto readRemaining = [](std::istream& stream) { return std::string(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>()); };
+		std::ifstream stencil(findTestFile("stencil_binary.stl"), std::ios::binary);
+		std::string embedded = readRemaining(stencil) + "TRAILER";
+		std::istringstream embeddedStream(embedded);
+		res = microstl::Reader::readStlStream(embeddedStream, handler);
+		REQUIRE(res == microstl::Result::Success && !handler.ascii && handler.mesh.facets.size() == 2330);
+		REQUIRE(embeddedStream.good() && readRemaining(embeddedStream) == "TRAILER");
+		buffer.data.assign(embedded.begin(), embedded.end());
+		buffer.rewind();
+		is.clear();
+		res = microstl::Reader::readStlStream(is, handler);
+		REQUIRE(res == microstl::Result::Success && !handler.ascii && handler.mesh.facets.size() == 2330);
+		REQUIRE(is.good() && readRemaining(is) == "TRAILER");
+
+		// Seekable streams also get back the sniffed prefix behind very small binary data
+		uint32_t oneFacet = 1;
+		memset(data.data(), 0, 80);
+		memcpy(data.data() + 80, &oneFacet, sizeof(oneFacet));
+		std::istringstream smallStream(std::string(data.data(), 134) + "TRAILER");
+		res = microstl::Reader::readStlStream(smallStream, handler);
+		REQUIRE(res == microstl::Result::Success && !handler.ascii && handler.mesh.facets.size() == 1);
+		REQUIRE(readRemaining(smallStream) == "TRAILER");
+
+		// The stream state is passed on to the caller
+		std::ifstream asciiStream(findTestFile("simple_ascii.stl"), std::ios::binary);
+		res = microstl::Reader::readStlStream(asciiStream, handler);
+		REQUIRE(res == microstl::Result::Success && asciiStream.eof());
+	}
+
+	{
+		TEST_SCOPE("Deduplicate vertices while parsing with the face-vertex mesh handler");
+		for (const auto& file : { "box_meshlab_ascii.stl", "half_donut_ascii.stl", "stencil_binary.stl", "sphere_binary.stl", "incomplete_binary.stl" })
+		{
+			microstl::MeshReaderHandler meshHandler;
+			auto expectedResult = microstl::Reader::readStlFile(findTestFile(file), meshHandler);
+			auto expected = microstl::deduplicateVertices(meshHandler.mesh);
+
+			microstl::FVMeshReaderHandler handler;
+			handler.name = "old";
+			auto res = microstl::Reader::readStlFile(findTestFile(file), handler);
+			REQUIRE(res == expectedResult && res == handler.result);
+			REQUIRE(handler.ascii == meshHandler.ascii);
+			REQUIRE(handler.name == meshHandler.name);
+			REQUIRE(handler.header == meshHandler.header);
+			REQUIRE(handler.mesh.vertices.size() == expected.vertices.size());
+			REQUIRE(handler.mesh.facets.size() == expected.facets.size());
+			REQUIRE(memcmp(handler.mesh.vertices.data(), expected.vertices.data(), expected.vertices.size() * sizeof(microstl::Vertex)) == 0);
+			for (size_t i = 0; i < expected.facets.size(); i++)
+			{
+				const auto& a = handler.mesh.facets[i];
+				const auto& b = expected.facets[i];
+				REQUIRE(a.v1 == b.v1 && a.v2 == b.v2 && a.v3 == b.v3);
+				REQUIRE(memcmp(&a.n, &b.n, sizeof(microstl::Normal)) == 0);
+			}
+		}
+
+		// Negative zero is merged with positive zero, NaN vertices are never merged
+		const float nan = std::numeric_limits<float>::quiet_NaN();
+		microstl::Mesh mesh;
+		mesh.facets.push_back({ { 0, 0, 0 }, { 1, 0, 0 }, { nan, 0, 0 }, { 0, 0, 1 } });
+		mesh.facets.push_back({ { -0.0f, 0, -0.0f }, { nan, 0, 0 }, { 1, 0, 0 }, { 0, 0, 1 } });
+		auto fvMesh = microstl::deduplicateVertices(mesh);
+		REQUIRE(fvMesh.vertices.size() == 4);
+		REQUIRE(fvMesh.facets[1].v1 == 0 && fvMesh.facets[1].v3 == 1);
+		REQUIRE(fvMesh.facets[0].v3 == 2 && fvMesh.facets[1].v2 == 3);
+
+		// Many unique vertices cause multiple rehashes of the table
+		microstl::VertexIndexTable table;
+		std::vector<microstl::Vertex> vertices;
+		for (int i = 0; i < 100000; i++)
+			REQUIRE(table.insert(vertices, { float(i % 1000), float(i / 1000), 0.5f }) == size_t(i));
+		for (int i = 0; i < 100000; i += 7)
+			REQUIRE(table.insert(vertices, { float(i % 1000), float(i / 1000), 0.5f }) == size_t(i));
+		REQUIRE(vertices.size() == 100000);
+	}
+
+	{
+		TEST_SCOPE("Optimize the facet and vertex order and build meshlets");
+		microstl::FVMeshReaderHandler handler;
+		auto res = microstl::Reader::readStlFile(findTestFile("sphere_binary.stl"), handler);
+		REQUIRE(res == microstl::Result::Success);
+		const microstl::FVMesh original = handler.mesh;
+		microstl::FVMesh mesh = handler.mesh;
+		auto before = microstl::analyzeVertexCache(mesh);
+		REQUIRE(before.transformedVertices > 0 && before.atvr >= 1.0);
+
+		// Facets are only reordered, so the sorted facet coordinates must be the same
+		auto sortedFacets = [](const microstl::FVMesh& m)
+		{
+			std::vector<std::array<float, 12>> facets;
+			for (const auto& f : m.facets)
+			{
+				const auto& a = m.vertices[f.v1];
+				const auto& b = m.vertices[f.v2];
+				const auto& c = m.vertices[f.v3];
+				facets.push_back({ a.x, a.y, a.z, b.x, b.y, b.z, c.x, c.y, c.z, f.n.x, f.n.y, f.n.z });
+			}
+			std::sort(facets.begin(), facets.end());
+			return facets;
+		};
+		microstl::optimizeVertexCache(mesh);
+		auto after = microstl::analyzeVertexCache(mesh);
+		REQUIRE(after.acmr < before.acmr * 0.5 && after.acmr < 0.8);
+		REQUIRE(sortedFacets(mesh) == sortedFacets(original));
+
+		// Vertices are stored in the order of their first use
+		microstl::optimizeVertexFetch(mesh);
+		REQUIRE(mesh.vertices.size() == original.vertices.size());
+		REQUIRE(sortedFacets(mesh) == sortedFacets(original));
+		size_t nextVertex = 0;
+		for (const auto& f : mesh.facets)
+			for (size_t v : { f.v1, f.v2, f.v3 })
+			{
+				REQUIRE(v <= nextVertex);
+				if (v == nextVertex)
+					nextVertex++;
+			}
+		REQUIRE(microstl::analyzeVertexCache(mesh).transformedVertices == after.transformedVertices);
+
+		// Meshlets must respect the limits and reference the same vertices as the facets
+		auto meshlets = microstl::buildMeshlets(mesh, 32, 40);
+		REQUIRE(meshlets.indices.size() == mesh.facets.size() * 3);
+		size_t facetCount = 0;
+		for (const auto& meshlet : meshlets.meshlets)
+		{
+			REQUIRE(meshlet.vertexCount <= 32 && meshlet.facetCount <= 40 && meshlet.facetCount > 0);
+			REQUIRE(meshlet.facetOffset == facetCount);
+			for (size_t t = meshlet.facetOffset; t < meshlet.facetOffset + meshlet.facetCount; t++)
+			{
+				const auto& f = mesh.facets[t];
+				const uint8_t* local = &meshlets.indices[3 * t];
+				REQUIRE(local[0] < meshlet.vertexCount && local[1] < meshlet.vertexCount && local[2] < meshlet.vertexCount);
+				REQUIRE(meshlets.vertices[meshlet.vertexOffset + local[0]] == f.v1);
+				REQUIRE(meshlets.vertices[meshlet.vertexOffset + local[1]] == f.v2);
+				REQUIRE(meshlets.vertices[meshlet.vertexOffset + local[2]] == f.v3);
+			}
+			facetCount += meshlet.facetCount;
+		}
+		REQUIRE(facetCount == mesh.facets.size());
+
+		bool exception = false;
+		try { microstl::buildMeshlets(mesh, 300, 100); }
+		catch (const std::runtime_error&) { exception = true; }
+		REQUIRE(exception);
+
+		// Empty meshes
+		microstl::FVMesh empty;
+		microstl::optimizeVertexCache(empty);
+		microstl::optimizeVertexFetch(empty);
+		REQUIRE(microstl::analyzeVertexCache(empty).acmr == 0);
+		REQUIRE(microstl::buildMeshlets(empty).meshlets.empty());
+	}
+
+	{
+		TEST_SCOPE("Quantize meshes into the compact representation and decode them again");
+		microstl::MeshReaderHandler handler;
+		auto res = microstl::Reader::readStlFile(findTestFile("stencil_binary.stl"), handler);
+		REQUIRE(res == microstl::Result::Success);
+		const microstl::FVMesh mesh = microstl::deduplicateVertices(handler.mesh);
+		const size_t originalSize = mesh.vertices.size() * sizeof(microstl::Vertex) + mesh.facets.size() * sizeof(microstl::FVFacet);
+
+		auto check = [&](const microstl::QuantizedMesh& quantized)
+		{
+			auto decoded = microstl::dequantizeMesh(quantized);
+			REQUIRE(decoded.vertices.size() == mesh.vertices.size());
+			REQUIRE(decoded.facets.size() == mesh.facets.size());
+			const float tolerance = quantized.getMaxError() * 1.01f + 1e-6f;
+			for (size_t i = 0; i < mesh.vertices.size(); i++)
+			{
+				REQUIRE(std::abs(decoded.vertices[i].x - mesh.vertices[i].x) <= tolerance);
+				REQUIRE(std::abs(decoded.vertices[i].y - mesh.vertices[i].y) <= tolerance);
+				REQUIRE(std::abs(decoded.vertices[i].z - mesh.vertices[i].z) <= tolerance);
+			}
+			for (size_t i = 0; i < mesh.facets.size(); i++)
+			{
+				const auto& a = decoded.facets[i];
+				const auto& b = mesh.facets[i];
+				REQUIRE(a.v1 == b.v1 && a.v2 == b.v2 && a.v3 == b.v3);
+				REQUIRE(a.n.x * b.n.x + a.n.y * b.n.y + a.n.z * b.n.z > 0.9999f);
+			}
+		};
+
+		auto quantized16 = microstl::quantizeMesh(mesh);
+		REQUIRE(quantized16.bits == 16 && quantized16.positions21.empty());
+		REQUIRE(quantized16.getMemorySize() * 3 < originalSize);
+		check(quantized16);
+
+		// A tighter error bound switches to 21 bits
+		microstl::QuantizationSettings settings;
+		settings.maxError = quantized16.getMaxError() * 0.5f;
+		auto quantized21 = microstl::quantizeMesh(handler.mesh, settings);
+		REQUIRE(quantized21.bits == 21 && quantized21.positions16.empty());
+		REQUIRE(quantized21.getMaxError() <= settings.maxError);
+		check(quantized21);
+
+		bool exception = false;
+		settings.maxError = 1e-12f;
+		try { microstl::quantizeMesh(mesh, settings); }
+		catch (const std::runtime_error&) { exception = true; }
+		REQUIRE(exception);
+		exception = false;
+		settings = microstl::QuantizationSettings();
+		settings.bits = 8;
+		try { microstl::quantizeMesh(mesh, settings); }
+		catch (const std::runtime_error&) { exception = true; }
+		REQUIRE(exception);
+
+		// Special normals and flat meshes
+		for (const microstl::Normal& n : { microstl::Normal{ 0, 0, -1 }, microstl::Normal{ 0, 0, 1 }, microstl::Normal{ -0.6f, 0, -0.8f } })
+		{
+			auto decoded = microstl::QuantizedMesh::decodeNormal(microstl::QuantizedMesh::encodeNormal(n));
+			REQUIRE(decoded.x * n.x + decoded.y * n.y + decoded.z * n.z > 0.9999f);
+		}
+		auto zero = microstl::QuantizedMesh::decodeNormal(microstl::QuantizedMesh::encodeNormal({ 0, 0, 0 }));
+		REQUIRE(zero.x == 0 && zero.y == 0 && zero.z == 0);
+		microstl::FVMesh flat;
+		flat.vertices = { { 1, 2, 3 }, { 1, 2, 3 }, { 1, 2, 3 } };
+		flat.facets.push_back({ 2, 0, 1, { 0, 0, 0 } });
+		auto decodedFlat = microstl::dequantizeMesh(microstl::quantizeMesh(flat));
+		REQUIRE(decodedFlat.vertices[1].x == 1 && decodedFlat.vertices[1].y == 2 && decodedFlat.vertices[1].z == 3);
+		REQUIRE(decodedFlat.facets[0].v1 == 2 && decodedFlat.facets[0].v2 == 0 && decodedFlat.facets[0].v3 == 1);
+		REQUIRE(microstl::dequantizeMesh(microstl::quantizeMesh(microstl::FVMesh())).vertices.empty());
+
+		// Inconsistent counts and bit sizes are rejected
+		auto corrupt = [](const std::function<void(microstl::QuantizedMesh&)>& modify)
+		{
+			microstl::FVMesh triangle;
+			triangle.vertices = { { 0, 0, 0 }, { 1, 0, 0 }, { 0, 1, 0 } };
+			triangle.facets.push_back({ 0, 1, 2, { 0, 0, 1 } });
+			auto quantized = microstl::quantizeMesh(triangle);
+			modify(quantized);
+			bool exception = false;
+			try { microstl::dequantizeMesh(quantized); }
+			catch (const std::runtime_error&) { exception = true; }
+			return exception;
+		};
+		REQUIRE(!corrupt([](microstl::QuantizedMesh&) {}));
+		REQUIRE(corrupt([](microstl::QuantizedMesh& q) { q.vertexCount++; }));
+		REQUIRE(corrupt([](microstl::QuantizedMesh& q) { q.positions16.pop_back(); }));
+		REQUIRE(corrupt([](microstl::QuantizedMesh& q) { q.facetCount++; }));
+		REQUIRE(corrupt([](microstl::QuantizedMesh& q) { q.normals.clear(); }));
+		REQUIRE(corrupt([](microstl::QuantizedMesh& q) { q.bits = 21; }));
+		REQUIRE(corrupt([](microstl::QuantizedMesh& q) { q.bits = 8; }));
+	}
+
+	{
+		TEST_SCOPE("Compute smooth vertex normals in parallel");
+		microstl::FVMeshReaderHandler handler;
+		auto res = microstl::Reader::readStlFile(findTestFile("sphere_binary.stl"), handler);
+		REQUIRE(res == microstl::Result::Success);
+		const auto& mesh = handler.mesh;
+
+		// Vertex normals of the coarse sphere around the origin point roughly away from its center
+		const microstl::Vertex center = { 0, 0, 0 };
+		for (auto weighting : { microstl::NormalWeighting::Uniform, microstl::NormalWeighting::Area, microstl::NormalWeighting::Angle })
+		{
+			auto normals = microstl::computeVertexNormals(mesh, weighting, 1);
+			REQUIRE(normals.size() == mesh.vertices.size());
+			for (size_t i = 0; i < normals.size(); i++)
+			{
+				microstl::Vertex d = { mesh.vertices[i].x - center.x, mesh.vertices[i].y - center.y, mesh.vertices[i].z - center.z };
+				float length = std::sqrt(d.x * d.x + d.y * d.y + d.z * d.z);
+				REQUIRE((normals[i].x * d.x + normals[i].y * d.y + normals[i].z * d.z) / length > 0.98f);
+			}
+
+			// Identical results for any thread count
+			for (size_t threads : { 2, 3, 8 })
+			{
+				auto parallelNormals = microstl::computeVertexNormals(mesh, weighting, threads);
+				REQUIRE(memcmp(parallelNormals.data(), normals.data(), normals.size() * sizeof(microstl::Normal)) == 0);
+			}
+		}
+
+		// Angle weighting is independent of the triangulation of the box sides
+		microstl::FVMeshReaderHandler boxHandler;
+		res = microstl::Reader::readStlFile(findTestFile("box_meshlab_ascii.stl"), boxHandler);
+		REQUIRE(res == microstl::Result::Success);
+		auto boxNormals = microstl::computeVertexNormals(boxHandler.mesh);
+		for (const auto& n : boxNormals)
+		{
+			REQUIRE(std::abs(std::abs(n.x) - 0.57735f) < 1e-4f);
+			REQUIRE(std::abs(std::abs(n.y) - 0.57735f) < 1e-4f);
+			REQUIRE(std::abs(std::abs(n.z) - 0.57735f) < 1e-4f);
+		}
+
+		// Unused vertices and degenerated facets
+		microstl::FVMesh degenerated;
+		degenerated.vertices = { { 0, 0, 0 }, { 1, 0, 0 }, { 2, 0, 0 }, { 5, 5, 5 } };
+		degenerated.facets.push_back({ 0, 1, 2, { 0, 0, 0 } });
+		for (const auto& n : microstl::computeVertexNormals(degenerated))
+			REQUIRE(n.x == 0 && n.y == 0 && n.z == 0);
+	}
+
+	{
+		TEST_SCOPE("Build the edge adjacency and analyze the mesh topology");
+		std::mt19937 random(42);
+		std::vector<uint32_t> values(100000);
+		for (auto& value : values)
+			value = random() % 5000;
+		auto expectedValues = values;
+		std::sort(expectedValues.begin(), expectedValues.end());
+		for (size_t threads : { 1, 2, 3, 8 })
+		{
+			auto sortedValues = values;
+			microstl::parallelSort(sortedValues, threads, std::less<uint32_t>());
+			REQUIRE(sortedValues == expectedValues);
+		}
+
+		// Closed meshes
+		for (const auto& file : { "box_meshlab_ascii.stl", "sphere_binary.stl" })
+		{
+			microstl::FVMeshReaderHandler handler;
+			auto res = microstl::Reader::readStlFile(findTestFile(file), handler);
+			REQUIRE(res == microstl::Result::Success);
+			microstl::EdgeAdjacency adjacency(handler.mesh);
+			REQUIRE(adjacency.getEdgeCount() * 2 == handler.mesh.facets.size() * 3);
+			REQUIRE(adjacency.isWatertight());
+			REQUIRE(adjacency.getBoundaryEdges().empty());
+			REQUIRE(adjacency.getNonManifoldEdges().empty());
+			REQUIRE(adjacency.getEulerCharacteristic() == 2);
+
+			// The facets of each edge must contain both vertices of the edge
+			for (size_t e = 0; e < adjacency.getEdgeCount(); e++)
+			{
+				const auto& edge = adjacency.getEdge(e);
+				REQUIRE(edge.v1 < edge.v2);
+				for (size_t i = 0; i < adjacency.getFacetCount(e); i++)
+				{
+					const auto& f = handler.mesh.facets[adjacency.getFacets(e)[i]];
+					REQUIRE(f.v1 == edge.v1 || f.v2 == edge.v1 || f.v3 == edge.v1);
+					REQUIRE(f.v1 == edge.v2 || f.v2 == edge.v2 || f.v3 == edge.v2);
+				}
+			}
+		}
+
+		// Open mesh with three facets at one edge and a degenerated facet
+		microstl::FVMesh mesh;
+		mesh.vertices = { { 0, 0, 0 }, { 1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 } };
+		mesh.facets.push_back({ 0, 1, 2, { 0, 0, 1 } });
+		mesh.facets.push_back({ 1, 0, 3, { 0, 0, 1 } });
+		mesh.facets.push_back({ 0, 1, 4, { 0, 1, 0 } });
+		mesh.facets.push_back({ 2, 2, 4, { 0, 0, 0 } });
+		microstl::EdgeAdjacency adjacency(mesh, 4);
+		REQUIRE(adjacency.getEdgeCount() == 8);
+		REQUIRE(!adjacency.isWatertight());
+		auto nonManifold = adjacency.getNonManifoldEdges();
+		REQUIRE(nonManifold.size() == 1);
+		REQUIRE(adjacency.getEdge(nonManifold[0]).v1 == 0 && adjacency.getEdge(nonManifold[0]).v2 == 1);
+		REQUIRE(adjacency.getFacetCount(nonManifold[0]) == 3);
+		REQUIRE(adjacency.getFacets(nonManifold[0])[2] == 2);
+		REQUIRE(adjacency.getBoundaryEdges().size() == 7);
+		REQUIRE(adjacency.getEulerCharacteristic() == 5 - 8 + 4);
+		REQUIRE(!microstl::EdgeAdjacency(microstl::FVMesh()).isWatertight());
+	}
+
+	{
+		TEST_SCOPE("Validate facets while parsing and afterwards");
+		const float inf = std::numeric_limits<float>::infinity();
+		const std::vector<std::array<float, 9>> vertices = {
+			{ 0, 0, 0, 1, 0, 0, 0, 1, 0 }, // Valid
+			{ 0, 0, 0, inf, 0, 0, 0, 1, 0 }, // Non-finite
+			{ 1, 1, 1, 1, 1, 1, 1, 1, 1 }, // Degenerated
+			{ 0, 0, 0, 1, 0, 0, 2, 0.001f, 0 }, // Sliver
+			{ 1e7f, 0, 0, 1e7f + 1, 0, 0, 1e7f, 1, 0 } // Out of range
+		};
+		std::string data(80, '\0');
+		uint32_t facetCount = static_cast<uint32_t>(vertices.size());
+		data.append(reinterpret_cast<const char*>(&facetCount), 4);
+		for (const auto& v : vertices)
+		{
+			const float normal[3] = { 0, 0, 0 };
+			data.append(reinterpret_cast<const char*>(normal), sizeof(normal));
+			data.append(reinterpret_cast<const char*>(v.data()), 9 * sizeof(float));
+			data.append("\1\0", 2);
+		}
+
+		microstl::ValidationSettings settings;
+		settings.minQuality = 0.01f;
+		settings.maxCoordinate = 1e6f;
+		microstl::MeshReaderHandler meshHandler;
+		microstl::ValidatingHandler dropHandler(meshHandler, microstl::ValidatingHandler::Mode::Drop, settings);
+		auto res = microstl::Reader::readStlBuffer(data.data(), data.size(), dropHandler);
+		REQUIRE(res == microstl::Result::Success && meshHandler.result == res);
+		REQUIRE(meshHandler.mesh.facets.size() == 1);
+		REQUIRE(meshHandler.mesh.facets[0].n.z == 1);
+		const auto& report = dropHandler.report;
+		REQUIRE(report.facetCount == 5 && report.invalidFacets == 4 && !report.isValid());
+		REQUIRE(report.nonFiniteFacets == 1 && report.degeneratedFacets == 1 && report.sliverFacets == 1 && report.outOfRangeFacets == 1);
+		REQUIRE(dropHandler.flaggedFacets.empty());
+
+		// Flagged facets are still forwarded, degenerated facets get a zero normal instead of NaN values
+		microstl::ValidatingHandler flagHandler(meshHandler, microstl::ValidatingHandler::Mode::Flag, settings);
+		res = microstl::Reader::readStlBuffer(data.data(), data.size(), flagHandler);
+		REQUIRE(res == microstl::Result::Success);
+		REQUIRE(meshHandler.mesh.facets.size() == 5);
+		REQUIRE((flagHandler.flaggedFacets == std::vector<size_t>{ 1, 2, 3, 4 }));
+		const auto& degenerated = meshHandler.mesh.facets[2];
+		REQUIRE(degenerated.n.x == 0 && degenerated.n.y == 0 && degenerated.n.z == 0);
+
+		// Validation after parsing
+		std::vector<size_t> invalidFacets;
+		auto meshReport = microstl::validateMesh(meshHandler.mesh, settings, &invalidFacets);
+		REQUIRE(meshReport.invalidFacets == 4 && invalidFacets == flagHandler.flaggedFacets);
+		REQUIRE(microstl::validateMesh(meshHandler.mesh).invalidFacets == 2);
+		auto removeReport = microstl::removeInvalidFacets(meshHandler.mesh, settings);
+		REQUIRE(removeReport.invalidFacets == 4 && meshHandler.mesh.facets.size() == 1);
+		REQUIRE(microstl::validateMesh(meshHandler.mesh, settings).isValid());
+
+		res = microstl::Reader::readStlFile(findTestFile("stencil_binary.stl"), flagHandler);
+		REQUIRE(res == microstl::Result::Success && flagHandler.report.facetCount == 2330);
+	}
+
+	{
+		TEST_SCOPE("Write binary STL files in parallel with positional writes");
+		microstl::MeshReaderHandler handler;
+		auto res = microstl::Reader::readStlFile(findTestFile("stencil_binary.stl"), handler);
+		REQUIRE(res == microstl::Result::Success);
+
+		auto readFile = [](const std::filesystem::path& path)
+		{
+			std::ifstream ifs(path, std::ios::binary);
+			return std::string((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+		};
+
+		microstl::MeshProvider provider(handler.mesh);
+		REQUIRE(provider.threadSafe());
+		res = microstl::Writer::writeStlFile("serial.stl", provider);
+		REQUIRE(res == microstl::Result::Success);
+		const std::string expected = readFile("serial.stl");
+		REQUIRE(expected.size() == 84 + 50 * handler.mesh.facets.size());
+		for (size_t threads : { 0, 1, 3 })
+		{
+			res = microstl::Writer::writeStlFileParallel("parallel.stl", provider, threads);
+			REQUIRE(res == microstl::Result::Success);
+			REQUIRE(readFile("parallel.stl") == expected);
+		}
+
+		// Face-vertex meshes and attributes from providers that are not thread-safe
+		auto fvMesh = microstl::deduplicateVertices(handler.mesh);
+		microstl::FVMeshProvider fvProvider(fvMesh);
+		res = microstl::Writer::writeStlFileParallel("parallel.stl", fvProvider, 2);
+		REQUIRE(res == microstl::Result::Success);
+		REQUIRE(readFile("parallel.stl") == expected);
+		struct AttributeProvider : microstl::MeshProvider
+		{
+			AttributeProvider(const microstl::Mesh& m) : MeshProvider(m) {}
+			bool writeAttributes() override { return true; }
+			bool threadSafe() override { return false; }
+			void getFacetAttributes(size_t index, uint8_t attributes[2]) override { attributes[0] = uint8_t(index); attributes[1] = 7; }
+		};
+		AttributeProvider attributeProvider(handler.mesh);
+		res = microstl::Writer::writeStlFileParallel("parallel.stl", attributeProvider, 2);
+		REQUIRE(res == microstl::Result::Success);
+		auto data = readFile("parallel.stl");
+		REQUIRE(data.size() == expected.size() && data[84 + 50 * 5 + 48] == 5 && data[84 + 50 * 5 + 49] == 7);
+
+		// Empty meshes and invalid paths
+		microstl::Mesh empty;
+		microstl::MeshProvider emptyProvider(empty);
+		res = microstl::Writer::writeStlFileParallel("parallel.stl", emptyProvider);
+		REQUIRE(res == microstl::Result::Success && readFile("parallel.stl").size() == 84);
+		res = microstl::Writer::writeStlFileParallel("does/not/exist.stl", provider);
+		REQUIRE(res == microstl::Result::FileError);
+
+		// Exceptions from the provider are passed on to the caller after all workers finished
+		struct ThrowingProvider : microstl::MeshProvider
+		{
+			ThrowingProvider(const microstl::Mesh& m) : MeshProvider(m) {}
+			void getFacet(size_t index, float v1[3], float v2[3], float v3[3], float n[3]) override
+			{
+				if (index == 1000)
+					throw std::runtime_error("Provider failure");
+				MeshProvider::getFacet(index, v1, v2, v3, n);
+			}
+		};
+		ThrowingProvider throwingProvider(handler.mesh);
+		bool exception = false;
+		try { microstl::Writer::writeStlFileParallel("parallel.stl", throwingProvider, 2); }
+		catch (const std::runtime_error&) { exception = true; }
+		REQUIRE(exception);
+		std::filesystem::remove("serial.stl");
+		std::filesystem::remove("parallel.stl");
+	}
+
+	{
+		TEST_SCOPE("Deduplicate vertices out of core with sorted runs in temporary files");
+		std::filesystem::path directory("external_dedup");
+		for (const auto& file : { "stencil_binary.stl", "half_donut_ascii.stl" })
+		{
+			microstl::MeshReaderHandler meshHandler;
+			auto res = microstl::Reader::readStlFile(findTestFile(file), meshHandler);
+			REQUIRE(res == microstl::Result::Success);
+			auto expected = microstl::deduplicateVertices(meshHandler.mesh);
+
+			// A tiny budget forces multiple runs, a large budget keeps everything in memory
+			for (size_t budget : { 0, 1 << 26 })
+			{
+				microstl::ExternalDeduplicationHandler handler(directory, budget);
+				res = microstl::Reader::readStlFile(findTestFile(file), handler);
+				REQUIRE(res == microstl::Result::Success && handler.result == res);
+				REQUIRE(handler.facetCount == expected.facets.size());
+				REQUIRE(handler.vertexCount == expected.vertices.size());
+				REQUIRE(std::filesystem::file_size(handler.vertexFile) == expected.vertices.size() * sizeof(microstl::Vertex));
+				REQUIRE(std::filesystem::file_size(handler.indexFile) == expected.facets.size() * 3 * sizeof(uint32_t));
+
+				// Vertices are sorted differently but the facets must reference the same coordinates
+				microstl::FVMesh mesh;
+				REQUIRE(handler.readFVMesh(mesh) == microstl::Result::Success);
+				for (size_t i = 0; i < mesh.facets.size(); i++)
+				{
+					const auto& f = mesh.facets[i];
+					const auto& e = meshHandler.mesh.facets[i];
+					REQUIRE(memcmp(&mesh.vertices[f.v1], &e.v1, sizeof(microstl::Vertex)) == 0);
+					REQUIRE(memcmp(&mesh.vertices[f.v2], &e.v2, sizeof(microstl::Vertex)) == 0);
+					REQUIRE(memcmp(&mesh.vertices[f.v3], &e.v3, sizeof(microstl::Vertex)) == 0);
+					REQUIRE(memcmp(&f.n, &e.n, sizeof(microstl::Normal)) == 0);
+				}
+				for (size_t i = 1; i < mesh.vertices.size(); i++)
+					REQUIRE(memcmp(&mesh.vertices[i - 1], &mesh.vertices[i], sizeof(microstl::Vertex)) != 0);
+			}
+		}
+
+		// More runs than can be merged at once need multiple merge passes
+		{
+			microstl::MeshReaderHandler meshHandler;
+			auto res = microstl::Reader::readStlFile(findTestFile("stencil_binary.stl"), meshHandler);
+			REQUIRE(res == microstl::Result::Success);
+			microstl::Mesh large;
+			for (size_t i = 0; i < 12; i++)
+				large.facets.insert(large.facets.end(), meshHandler.mesh.facets.begin(), meshHandler.mesh.facets.end());
+			REQUIRE(microstl::Writer::writeMeshFile("many_runs.stl", large) == microstl::Result::Success);
+			auto expected = microstl::deduplicateVertices(large);
+
+			microstl::ExternalDeduplicationHandler handler(directory, 0);
+			res = microstl::Reader::readStlFile("many_runs.stl", handler);
+			REQUIRE(res == microstl::Result::Success && handler.result == res);
+			REQUIRE(large.facets.size() * 3 / 1024 > 64);
+			REQUIRE(handler.vertexCount == expected.vertices.size());
+			microstl::FVMesh mesh;
+			mesh.pendingNormals.assign(1, true);
+			REQUIRE(handler.readFVMesh(mesh) == microstl::Result::Success);
+			REQUIRE(mesh.facets.size() == large.facets.size() && mesh.pendingNormals.empty());
+			for (size_t i = 0; i < mesh.facets.size(); i++)
+			{
+				const auto& f = mesh.facets[i];
+				const auto& e = expected.facets[i];
+				REQUIRE(memcmp(&mesh.vertices[f.v1], &expected.vertices[e.v1], sizeof(microstl::Vertex)) == 0);
+				REQUIRE(memcmp(&mesh.vertices[f.v2], &expected.vertices[e.v2], sizeof(microstl::Vertex)) == 0);
+				REQUIRE(memcmp(&mesh.vertices[f.v3], &expected.vertices[e.v3], sizeof(microstl::Vertex)) == 0);
+			}
+			std::filesystem::remove("many_runs.stl");
+		}
+
+		// Only the result files remain in the work directory
+		size_t fileCount = 0;
+		for (const auto& entry : std::filesystem::directory_iterator(directory))
+			fileCount += entry.is_regular_file();
+		REQUIRE(fileCount == 3);
+
+		microstl::ExternalDeduplicationHandler handler(directory);
+		auto res = microstl::Reader::readStlFile(findTestFile("incomplete_binary.stl"), handler);
+		REQUIRE(res == microstl::Result::MissingDataError && handler.result == res);
+		std::filesystem::remove_all(directory);
+	}
+
+	{
+		TEST_SCOPE("Decimate meshes with quadric error metrics");
+		microstl::FVMeshReaderHandler handler;
+		auto res = microstl::Reader::readStlFile(findTestFile("sphere_binary.stl"), handler);
+		REQUIRE(res == microstl::Result::Success);
+		const auto& sphere = handler.mesh;
+		auto radius = [](const microstl::Vertex& v) { return std::sqrt(v.x * v.x + v.y * v.y + v.z * v.z); };
+
+		// Edge collapses to a target facet count keep the sphere closed and round
+		microstl::DecimationSettings settings;
+		settings.targetFacetCount = sphere.facets.size() / 4;
+		auto decimated = microstl::decimateMesh(sphere, settings);
+		REQUIRE(decimated.facets.size() <= settings.targetFacetCount);
+		REQUIRE(decimated.facets.size() + 2 > settings.targetFacetCount);
+		REQUIRE(decimated.vertices.size() < sphere.vertices.size());
+		microstl::EdgeAdjacency adjacency(decimated);
+		REQUIRE(adjacency.isWatertight());
+		REQUIRE(adjacency.getEulerCharacteristic() == 2);
+		for (const auto& v : decimated.vertices)
+			REQUIRE(std::abs(radius(v) - 10.0f) < 0.5f);
+		for (const auto& f : decimated.facets)
+		{
+			const auto& v = decimated.vertices[f.v1];
+			REQUIRE(f.n.x * v.x + f.n.y * v.y + f.n.z * v.z > 0.0f);
+		}
+
+		// A zero error bound only allows collapses without any geometric error
+		settings.targetFacetCount = 0;
+		settings.maxError = 0.0;
+		REQUIRE(microstl::decimateMesh(sphere, settings).facets.size() == sphere.facets.size());
+
+		// Open meshes keep their boundary in place
+		microstl::FVMeshReaderHandler donutHandler;
+		res = microstl::Reader::readStlFile(findTestFile("half_donut_ascii.stl"), donutHandler);
+		REQUIRE(res == microstl::Result::Success);
+		auto bounds = [](const microstl::FVMesh& mesh, float minimum[3], float maximum[3])
+		{
+			for (int axis = 0; axis < 3; axis++)
+				minimum[axis] = INFINITY, maximum[axis] = -INFINITY;
+			for (const auto& v : mesh.vertices)
+			{
+				const float c[3] = { v.x, v.y, v.z };
+				for (int axis = 0; axis < 3; axis++)
+					minimum[axis] = std::min(minimum[axis], c[axis]), maximum[axis] = std::max(maximum[axis], c[axis]);
+			}
+		};
+		microstl::DecimationSettings donutSettings;
+		donutSettings.targetFacetCount = donutHandler.mesh.facets.size() / 2;
+		auto donut = microstl::decimateMesh(donutHandler.mesh, donutSettings);
+		REQUIRE(donut.facets.size() <= donutSettings.targetFacetCount);
+		REQUIRE(microstl::EdgeAdjacency(donut).getEulerCharacteristic() == microstl::EdgeAdjacency(donutHandler.mesh).getEulerCharacteristic());
+		float minimum1[3], maximum1[3], minimum2[3], maximum2[3];
+		bounds(donutHandler.mesh, minimum1, maximum1);
+		bounds(donut, minimum2, maximum2);
+		for (int axis = 0; axis < 3; axis++)
+			REQUIRE(std::abs(minimum1[axis] - minimum2[axis]) < 0.01f && std::abs(maximum1[axis] - maximum2[axis]) < 0.01f);
+
+		// Vertex clustering gives the same result for all thread counts
+		auto clustered = microstl::decimateMeshClustered(sphere, 8, 1);
+		REQUIRE(!clustered.facets.empty() && clustered.facets.size() < sphere.facets.size());
+		for (const auto& v : clustered.vertices)
+			REQUIRE(std::abs(radius(v) - 10.0f) < 1.5f);
+		for (size_t threads : { 2, 3, 8 })
+		{
+			auto other = microstl::decimateMeshClustered(sphere, 8, threads);
+			REQUIRE(other.vertices.size() == clustered.vertices.size() && other.facets.size() == clustered.facets.size());
+			for (size_t i = 0; i < other.vertices.size(); i++)
+				REQUIRE(memcmp(&other.vertices[i], &clustered.vertices[i], sizeof(microstl::Vertex)) == 0);
+			for (size_t i = 0; i < other.facets.size(); i++)
+				REQUIRE(other.facets[i].v1 == clustered.facets[i].v1 && other.facets[i].v2 == clustered.facets[i].v2 && other.facets[i].v3 == clustered.facets[i].v3);
+		}
+		REQUIRE(microstl::decimateMeshClustered(sphere, 1000).facets.size() == sphere.facets.size());
+		bool exception = false;
+		try { microstl::decimateMeshClustered(sphere, 0); }
+		catch (const std::runtime_error&) { exception = true; }
+		REQUIRE(exception);
+
+		// The result can be written directly
+		microstl::FVMeshProvider provider(decimated);
+		res = microstl::Writer::writeStlFile("decimated.stl", provider);
+		REQUIRE(res == microstl::Result::Success);
+		microstl::FVMeshReaderHandler checkHandler;
+		res = microstl::Reader::readStlFile("decimated.stl", checkHandler);
+		REQUIRE(res == microstl::Result::Success && checkHandler.mesh.facets.size() == decimated.facets.size());
+		std::filesystem::remove("decimated.stl");
+	}
+
+	{
+		TEST_SCOPE("Slice meshes into layer contours in parallel");
+		auto signedArea = [](const microstl::Slices& slices, size_t contour)
+		{
+			double area = 0.0;
+			size_t begin = slices.contourOffsets[contour], end = slices.contourOffsets[contour + 1];
+			for (size_t i = begin; i < end; i++)
+			{
+				const auto& a = slices.points[i];
+				const auto& b = slices.points[i + 1 < end ? i + 1 : begin];
+				area += 0.5 * (double(a.x) * b.y - double(b.x) * a.y);
+			}
+			return area;
+		};
+
+		// The box has one square contour in each layer
+		microstl::FVMeshReaderHandler boxHandler;
+		auto res = microstl::Reader::readStlFile(findTestFile("box_meshlab_ascii.stl"), boxHandler);
+		REQUIRE(res == microstl::Result::Success);
+		auto box = microstl::sliceMesh(boxHandler.mesh, 1.0f);
+		REQUIRE(box.getLayerCount() == 20);
+		REQUIRE(box.heights[0] == 0.5f && box.heights[19] == 19.5f);
+		REQUIRE(box.layerOffsets.size() == 21 && box.contourOffsets.size() == 21);
+		for (size_t l = 0; l < box.getLayerCount(); l++)
+		{
+			REQUIRE(box.layerOffsets[l + 1] - box.layerOffsets[l] == 1);
+			REQUIRE(box.closed[l] == 1);
+			REQUIRE(std::abs(signedArea(box, l) - 400.0) < 0.01);
+		}
+
+		// Sphere contours are counter-clockwise circles and do not depend on the thread count
+		microstl::FVMeshReaderHandler sphereHandler;
+		res = microstl::Reader::readStlFile(findTestFile("sphere_binary.stl"), sphereHandler);
+		REQUIRE(res == microstl::Result::Success);
+		std::vector<float> heights = { -9.5f, -5.0f, 0.0f, 3.25f, 9.0f, 20.0f };
+		auto sphere = microstl::sliceMesh(sphereHandler.mesh, heights, 1);
+		REQUIRE(sphere.getLayerCount() == heights.size());
+		REQUIRE(sphere.layerOffsets.back() == 5);
+		for (size_t l = 0; l < 5; l++)
+		{
+			REQUIRE(sphere.layerOffsets[l + 1] - sphere.layerOffsets[l] == 1);
+			size_t contour = sphere.layerOffsets[l];
+			REQUIRE(sphere.closed[contour] == 1);
+			REQUIRE(signedArea(sphere, contour) > 0.0);
+			const float expectedRadius = std::sqrt(100.0f - heights[l] * heights[l]);
+			for (size_t i = sphere.contourOffsets[contour]; i < sphere.contourOffsets[contour + 1]; i++)
+			{
+				const auto& p = sphere.points[i];
+				REQUIRE(std::abs(std::sqrt(p.x * p.x + p.y * p.y) - expectedRadius) < 0.1f * expectedRadius + 0.1f);
+			}
+		}
+		for (size_t threads : { 2, 3, 8 })
+		{
+			auto other = microstl::sliceMesh(sphereHandler.mesh, heights, threads);
+			REQUIRE(other.layerOffsets == sphere.layerOffsets && other.contourOffsets == sphere.contourOffsets);
+			REQUIRE(other.closed == sphere.closed && other.points.size() == sphere.points.size());
+			REQUIRE(memcmp(other.points.data(), sphere.points.data(), sphere.points.size() * sizeof(microstl::Slices::Point)) == 0);
+		}
+
+		// Open meshes produce open contours, a box without one side has a single open contour per layer
+		auto openBox = boxHandler.mesh;
+		openBox.facets.erase(std::remove_if(openBox.facets.begin(), openBox.facets.end(),
+			[](const microstl::FVFacet& f) { return f.n.x > 0.5f; }), openBox.facets.end());
+		REQUIRE(openBox.facets.size() == 10);
+		auto open = microstl::sliceMesh(openBox, 1.0f, 2);
+		REQUIRE(open.getLayerCount() == 20 && open.getContourCount() == 20);
+		REQUIRE(std::count(open.closed.begin(), open.closed.end(), 0) == 20);
+		for (size_t c = 0; c < open.getContourCount(); c++)
+			REQUIRE(open.contourOffsets[c + 1] - open.contourOffsets[c] >= 2u);
+
+		// Closed and watertight meshes with multiple contours per layer
+		microstl::FVMeshReaderHandler donutHandler;
+		res = microstl::Reader::readStlFile(findTestFile("half_donut_ascii.stl"), donutHandler);
+		REQUIRE(res == microstl::Result::Success);
+		auto donut = microstl::sliceMesh(donutHandler.mesh, 0.5f, 2);
+		REQUIRE(donut.getContourCount() > 0);
+		REQUIRE(donut.contourOffsets.back() == donut.points.size());
+		for (size_t c = 0; c < donut.getContourCount(); c++)
+			REQUIRE(donut.contourOffsets[c + 1] - donut.contourOffsets[c] >= (donut.closed[c] ? 3u : 2u));
+
+		// Invalid parameters
+		bool exception = false;
+		try { microstl::sliceMesh(boxHandler.mesh, 0.0f); }
+		catch (const std::runtime_error&) { exception = true; }
+		REQUIRE(exception);
+		exception = false;
+		try { microstl::sliceMesh(boxHandler.mesh, std::vector<float>{ 2.0f, 1.0f }); }
+		catch (const std::runtime_error&) { exception = true; }
+		REQUIRE(exception);
+		exception = false;
+		try { microstl::sliceMesh(boxHandler.mesh, 1e-6f); }
+		catch (const std::runtime_error&) { exception = true; }
+		REQUIRE(exception);
+		REQUIRE(microstl::sliceMesh(microstl::FVMesh(), 1.0f).getLayerCount() == 0);
+	}
+
+	{
+		TEST_SCOPE("Compute order-independent fingerprints of the geometry");
+		microstl::MeshReaderHandler meshHandler;
+		microstl::FingerprintHandler fingerprintHandler(meshHandler);
+		auto res = microstl::Reader::readStlFile(findTestFile("half_donut_ascii.stl"), fingerprintHandler);
+		REQUIRE(res == microstl::Result::Success);
+		const auto& mesh = meshHandler.mesh;
+		const auto fingerprint = fingerprintHandler.fingerprint;
+		REQUIRE(fingerprint.getFacetCount() == mesh.facets.size());
+		REQUIRE(!fingerprint.includesNormals());
+		REQUIRE(microstl::computeFingerprint(mesh) == fingerprint);
+		REQUIRE(microstl::computeFingerprint(microstl::deduplicateVertices(mesh), false, 3) == fingerprint);
+
+		// Binary export, shuffled facets and rotated vertices do not change the fingerprint
+		microstl::MeshProvider provider(mesh);
+		res = microstl::Writer::writeStlFile("fingerprint.stl", provider);
+		REQUIRE(res == microstl::Result::Success);
+		microstl::FingerprintHandler binaryHandler;
+		res = microstl::Reader::readStlFile("fingerprint.stl", binaryHandler);
+		REQUIRE(res == microstl::Result::Success);
+		REQUIRE(binaryHandler.fingerprint == fingerprint);
+		REQUIRE(binaryHandler.fingerprint.getValue() == fingerprint.getValue());
+		std::filesystem::remove("fingerprint.stl");
+
+		microstl::Mesh shuffled = mesh;
+		std::mt19937 random(7);
+		std::shuffle(shuffled.facets.begin(), shuffled.facets.end(), random);
+		for (size_t i = 0; i < shuffled.facets.size(); i++)
+		{
+			auto& f = shuffled.facets[i];
+			if (i % 3 == 1)
+				f = microstl::Facet{ f.v2, f.v3, f.v1, f.n };
+			else if (i % 3 == 2)
+				f = microstl::Facet{ f.v3, f.v1, f.v2, f.n };
+			f.n = { 0, 0, 0 };
+		}
+		for (size_t threads : { 1, 2, 8 })
+			REQUIRE(microstl::computeFingerprint(shuffled, false, threads) == fingerprint);
+
+		// Normals are only part of the fingerprint on request
+		REQUIRE(microstl::computeFingerprint(shuffled, true) != microstl::computeFingerprint(mesh, true));
+		REQUIRE(microstl::computeFingerprint(mesh, true).getValue() != fingerprint.getValue());
+
+		// Flipped orientation, moved vertices and missing facets change the fingerprint
+		microstl::Mesh changed = mesh;
+		std::swap(changed.facets[0].v1, changed.facets[0].v2);
+		REQUIRE(microstl::computeFingerprint(changed) != fingerprint);
+		changed = mesh;
+		changed.facets[5].v3.x += 0.001f;
+		REQUIRE(microstl::computeFingerprint(changed) != fingerprint);
+		changed = mesh;
+		changed.facets.pop_back();
+		REQUIRE(microstl::computeFingerprint(changed) != fingerprint);
+
+		// Fingerprints of parts can be merged
+		microstl::Mesh first, second;
+		first.facets.assign(mesh.facets.begin(), mesh.facets.begin() + 10);
+		second.facets.assign(mesh.facets.begin() + 10, mesh.facets.end());
+		auto merged = microstl::computeFingerprint(second);
+		merged.merge(microstl::computeFingerprint(first));
+		REQUIRE(merged == fingerprint);
+		merged.clear();
+		REQUIRE(merged == microstl::computeFingerprint(microstl::Mesh()));
+	}
+
+	{
+		TEST_SCOPE("Fingerprints survive the rounding of an ASCII export");
+		microstl::MeshReaderHandler binaryHandler;
+		microstl::FingerprintHandler binaryFingerprint(binaryHandler, true);
+		auto res = microstl::Reader::readStlFile(findTestFile("sphere_binary.stl"), binaryFingerprint);
+		REQUIRE(res == microstl::Result::Success);
+		REQUIRE(binaryFingerprint.fingerprint.getSignificantDigits() == microstl::Fingerprint::DEFAULT_SIGNIFICANT_DIGITS);
+
+		// Write the mesh as ASCII STL with the default precision and read it again
+		microstl::MeshProvider provider(binaryHandler.mesh);
+		provider.ascii = true;
+		std::string ascii;
+		REQUIRE(microstl::Writer::writeStlBuffer(ascii, provider) == microstl::Result::Success);
+		microstl::MeshReaderHandler asciiHandler;
+		microstl::FingerprintHandler asciiFingerprint(asciiHandler, true);
+		res = microstl::Reader::readStlBuffer(ascii.data(), ascii.size(), asciiFingerprint);
+		REQUIRE(res == microstl::Result::Success && asciiHandler.ascii);
+		REQUIRE(asciiFingerprint.fingerprint == binaryFingerprint.fingerprint);
+		REQUIRE(microstl::computeFingerprint(asciiHandler.mesh, true) == binaryFingerprint.fingerprint);
+
+		// The exact values differ after the export
+		auto exactBinary = microstl::computeFingerprint(binaryHandler.mesh, true, 0, 0);
+		auto exactAscii = microstl::computeFingerprint(asciiHandler.mesh, true, 0, 0);
+		REQUIRE(exactBinary != exactAscii);
+		REQUIRE(exactBinary != binaryFingerprint.fingerprint);
+
+		// Negative zero is equal to positive zero
+		microstl::Mesh positive, negative;
+		positive.facets.push_back({ { 0, 0, 0 }, { 1, 0, 0 }, { 0, 1, 0 }, { 0, 0, 1 } });
+		negative.facets.push_back({ { -0.0f, 0, -0.0f }, { 1, -0.0f, 0 }, { 0, 1, 0 }, { -0.0f, 0, 1 } });
+		REQUIRE(microstl::computeFingerprint(positive, true) == microstl::computeFingerprint(negative, true));
+		REQUIRE(microstl::computeFingerprint(positive, true, 0, 0) == microstl::computeFingerprint(negative, true, 0, 0));
+	}
+
+	{
+		TEST_SCOPE("Partition meshes into balanced octree tiles");
+		REQUIRE(microstl::spreadMortonBits(0x1FFFFF) == 0x1249249249249249ull);
+		REQUIRE(microstl::spreadMortonBits(0x5) == 0x41);
+
+		microstl::MeshReaderHandler handler;
+		auto res = microstl::Reader::readStlFile(findTestFile("stencil_binary.stl"), handler);
+		REQUIRE(res == microstl::Result::Success);
+		const auto& mesh = handler.mesh;
+		microstl::TilingSettings settings;
+		settings.maxFacetsPerTile = mesh.facets.size() / 10;
+		auto tiling = microstl::partitionMesh(mesh, settings);
+		REQUIRE(tiling.tiles.size() > 1);
+		REQUIRE(tiling.facets.size() == mesh.facets.size());
+
+		// Every facet is in exactly one tile and its centroid is inside the tile cell
+		std::vector<size_t> sortedFacets = tiling.facets;
+		std::sort(sortedFacets.begin(), sortedFacets.end());
+		for (size_t i = 0; i < sortedFacets.size(); i++)
+			REQUIRE(sortedFacets[i] == i);
+		size_t offset = 0;
+		for (const auto& tile : tiling.tiles)
+		{
+			REQUIRE(tile.facetOffset == offset && tile.facetCount > 0);
+			REQUIRE(tile.facetCount <= settings.maxFacetsPerTile);
+			offset += tile.facetCount;
+			for (size_t i = tile.facetOffset; i < tile.facetOffset + tile.facetCount; i++)
+			{
+				const auto& f = mesh.facets[tiling.facets[i]];
+				const float centroid[3] = { (f.v1.x + f.v2.x + f.v3.x) / 3, (f.v1.y + f.v2.y + f.v3.y) / 3, (f.v1.z + f.v2.z + f.v3.z) / 3 };
+				const float corners[9] = { f.v1.x, f.v1.y, f.v1.z, f.v2.x, f.v2.y, f.v2.z, f.v3.x, f.v3.y, f.v3.z };
+				for (int axis = 0; axis < 3; axis++)
+				{
+					const float epsilon = 1e-4f * (tile.cellMaximum[axis] - tile.cellMinimum[axis]) + 1e-5f;
+					REQUIRE(centroid[axis] >= tile.cellMinimum[axis] - epsilon && centroid[axis] <= tile.cellMaximum[axis] + epsilon);
+					for (int k = axis; k < 9; k += 3)
+						REQUIRE(corners[k] >= tile.boundsMinimum[axis] && corners[k] <= tile.boundsMaximum[axis]);
+				}
+			}
+		}
+
+		// The result does not depend on the thread count and the mesh type
+		auto fvMesh = microstl::deduplicateVertices(mesh);
+		for (size_t threads : { 1, 3 })
+		{
+			settings.threadCount = threads;
+			auto other = microstl::partitionMesh(fvMesh, settings);
+			REQUIRE(other.facets == tiling.facets && other.tiles.size() == tiling.tiles.size());
+			for (size_t t = 0; t < other.tiles.size(); t++)
+			{
+				const auto& a = other.tiles[t];
+				const auto& b = tiling.tiles[t];
+				REQUIRE(a.level == b.level && a.mortonPrefix == b.mortonPrefix && a.facetOffset == b.facetOffset && a.facetCount == b.facetCount);
+				REQUIRE(memcmp(a.boundsMinimum, b.boundsMinimum, sizeof(float) * 3) == 0 && memcmp(a.cellMaximum, b.cellMaximum, sizeof(float) * 3) == 0);
+			}
+		}
+
+		// Tiles can be extracted in memory
+		size_t tileFacets = 0;
+		for (size_t t = 0; t < tiling.tiles.size(); t++)
+		{
+			auto tileMesh = microstl::extractTile(mesh, tiling, t);
+			auto tileFVMesh = microstl::extractTile(fvMesh, tiling, t);
+			REQUIRE(tileMesh.facets.size() == tiling.tiles[t].facetCount);
+			REQUIRE(microstl::computeFingerprint(tileFVMesh) == microstl::computeFingerprint(tileMesh));
+			REQUIRE(tileFVMesh.vertices.size() <= tileMesh.facets.size() * 3);
+			tileFacets += tileMesh.facets.size();
+		}
+		REQUIRE(tileFacets == mesh.facets.size());
+
+		// Tiles and the manifest can be written to disk
+		std::filesystem::path directory("tiles");
+		microstl::MeshProvider provider(mesh);
+		res = microstl::writeTiles(directory, tiling, provider);
+		REQUIRE(res == microstl::Result::Success);
+		std::ifstream manifest(directory / "manifest.txt");
+		std::string line;
+		std::getline(manifest, line);
+		REQUIRE(line[0] == '#');
+		microstl::Fingerprint combined;
+		for (size_t t = 0; t < tiling.tiles.size(); t++)
+		{
+			std::string name;
+			size_t level = 0, facetCount = 0;
+			float bounds[12];
+			REQUIRE(manifest >> name >> level >> facetCount);
+			for (float& value : bounds)
+				REQUIRE(manifest >> value);
+			REQUIRE(level == tiling.tiles[t].level && facetCount == tiling.tiles[t].facetCount);
+			REQUIRE(bounds[0] == tiling.tiles[t].boundsMinimum[0] && bounds[11] == tiling.tiles[t].cellMaximum[2]);
+			microstl::FingerprintHandler tileHandler;
+			res = microstl::Reader::readStlFile(directory / name, tileHandler);
+			REQUIRE(res == microstl::Result::Success && tileHandler.fingerprint.getFacetCount() == facetCount);
+			combined.merge(tileHandler.fingerprint);
+		}
+		REQUIRE(combined == microstl::computeFingerprint(mesh));
+		manifest.close();
+		std::filesystem::remove_all(directory);
+
+		// Small meshes fit into the root cell
+		auto single = microstl::partitionMesh(mesh);
+		REQUIRE(single.tiles.size() == 1 && single.tiles[0].level == 0 && single.tiles[0].facetCount == mesh.facets.size());
+		REQUIRE(microstl::partitionMesh(microstl::Mesh()).tiles.empty());
+	}
+
+	{
+		TEST_SCOPE("Write meshes with the templated writer functions");
+		microstl::MeshReaderHandler handler;
+		auto res = microstl::Reader::readStlFile(findTestFile("half_donut_ascii.stl"), handler);
+		REQUIRE(res == microstl::Result::Success);
+		const auto& mesh = handler.mesh;
+		const auto fvMesh = microstl::deduplicateVertices(mesh);
+
+		// The output must be identical to the provider based writer
+		for (bool ascii : { false, true })
+		{
+			for (bool clearNormals : { false, true })
+			{
+				microstl::WriteOptions options;
+				options.ascii = ascii;
+				options.clearNormals = clearNormals;
+				microstl::MeshProvider provider(mesh);
+				provider.ascii = ascii;
+				provider.clearNormals = clearNormals;
+				std::string expected, buffer;
+				REQUIRE(microstl::Writer::writeStlBuffer(expected, provider) == microstl::Result::Success);
+				REQUIRE(microstl::Writer::writeMeshBuffer(buffer, mesh, options) == microstl::Result::Success);
+				REQUIRE(buffer == expected);
+				REQUIRE(microstl::Writer::writeMeshBuffer(buffer, fvMesh, options) == microstl::Result::Success);
+				REQUIRE(buffer == expected);
+			}
+		}
+
+		// Any type with getFacetCount() and getFacet() can be written without a provider
+		struct SingleFacet
+		{
+			size_t getFacetCount() const { return 1; }
+			void getFacet(size_t index, float v1[3], float v2[3], float v3[3], float n[3]) const
+			{
+				for (int i = 0; i < 3; i++)
+				{
+					v1[i] = float(i);
+					v2[i] = float(i + 3);
+					v3[i] = float(i + 6);
+					n[i] = 0.0f;
+				}
+			}
+		};
+		res = microstl::Writer::writeMeshFile("templated.stl", SingleFacet());
+		REQUIRE(res == microstl::Result::Success);
+		microstl::MeshReaderHandler checkHandler;
+		res = microstl::Reader::readStlFile("templated.stl", checkHandler);
+		REQUIRE(res == microstl::Result::Success && !checkHandler.ascii);
+		REQUIRE(checkHandler.mesh.facets.size() == 1 && checkHandler.mesh.facets[0].v3.z == 8.0f);
+		REQUIRE(std::filesystem::file_size("templated.stl") == 84 + 50);
+		std::filesystem::remove("templated.stl");
+
+		// Empty meshes and invalid paths
+		std::string buffer;
+		REQUIRE(microstl::Writer::writeMeshBuffer(buffer, microstl::Mesh()) == microstl::Result::Success && buffer.size() == 84);
+		REQUIRE(microstl::Writer::writeMeshFile("does/not/exist.stl", mesh) == microstl::Result::FileError);
+	}
+
+	{
+		TEST_SCOPE("Defer the normal recalculation with lazy normals");
+		const std::string data =
+			"solid lazy\n"
+			"facet normal 0 0 0\n outer loop\n vertex 0 0 0\n vertex 1 0 0\n vertex 0 1 0\n endloop\nendfacet\n"
+			"facet normal 0 0 1\n outer loop\n vertex 0 0 1\n vertex 1 0 1\n vertex 0 1 1\n endloop\nendfacet\n"
+			"facet normal 0 0 5\n outer loop\n vertex 0 0 0\n vertex 0 1 0\n vertex 1 0 0\n endloop\nendfacet\n"
+			"endsolid lazy\n";
+		auto sameNormal = [](const microstl::Normal& a, const microstl::Normal& b) { return a.x == b.x && a.y == b.y && a.z == b.z; };
+
+		REQUIRE(microstl::Reader::needsNormalFix(std::array<float, 3>{ 0, 0, 0 }.data()));
+		REQUIRE(microstl::Reader::needsNormalFix(std::array<float, 3>{ 0, 2, 0 }.data()));
+		REQUIRE(!microstl::Reader::needsNormalFix(std::array<float, 3>{ 0, 0, -1 }.data()));
+
+		microstl::MeshReaderHandler eager;
+		auto res = microstl::Reader::readStlBuffer(data.data(), data.size(), eager);
+		REQUIRE(res == microstl::Result::Success && eager.mesh.pendingNormals.empty());
+
+		// Only the raw normals and the pending flags are stored while parsing
+		microstl::MeshReaderHandler lazy;
+		lazy.lazyNormals = true;
+		res = microstl::Reader::readStlBuffer(data.data(), data.size(), lazy);
+		REQUIRE(res == microstl::Result::Success);
+		auto& mesh = lazy.mesh;
+		REQUIRE(mesh.pendingNormals == std::vector<bool>({ true, false, true }));
+		REQUIRE(mesh.facets[0].n.z == 0.0f && mesh.facets[2].n.z == 5.0f);
+		for (size_t i = 0; i < mesh.facets.size(); i++)
+			REQUIRE(sameNormal(microstl::getFacetNormal(mesh, i), eager.mesh.facets[i].n));
+
+		// Writers and conversions see the correct normals
+		std::string expected, buffer;
+		microstl::MeshProvider eagerProvider(eager.mesh);
+		microstl::MeshProvider lazyProvider(mesh);
+		REQUIRE(microstl::Writer::writeStlBuffer(expected, eagerProvider) == microstl::Result::Success);
+		REQUIRE(microstl::Writer::writeStlBuffer(buffer, lazyProvider) == microstl::Result::Success);
+		REQUIRE(buffer == expected);
+		REQUIRE(microstl::Writer::writeMeshBuffer(buffer, mesh) == microstl::Result::Success);
+		REQUIRE(buffer == expected);
+		auto fvMesh = microstl::deduplicateVertices(mesh);
+		REQUIRE(fvMesh.pendingNormals == mesh.pendingNormals);
+		REQUIRE(microstl::Writer::writeMeshBuffer(buffer, fvMesh) == microstl::Result::Success);
+		REQUIRE(buffer == expected);
+		REQUIRE(microstl::computeFingerprint(mesh, true) == microstl::computeFingerprint(eager.mesh, true));
+
+		// Appended facets are not pending and pending non-finite normals are not reported as invalid
+		auto extended = mesh;
+		extended.facets.push_back(eager.mesh.facets[1]);
+		extended.facets[3].n.z = 3.0f;
+		REQUIRE(sameNormal(microstl::getFacetNormal(extended, 3), extended.facets[3].n));
+		extended.facets[0].n.x = INFINITY;
+		REQUIRE(microstl::validateMesh(extended).isValid());
+		extended.facets.resize(2);
+		microstl::fixNormals(extended);
+		REQUIRE(extended.pendingNormals.empty() && sameNormal(extended.facets[0].n, eager.mesh.facets[0].n));
+
+		// The batch fix replaces the pending normals
+		microstl::fixNormals(mesh);
+		REQUIRE(mesh.pendingNormals.empty());
+		for (size_t i = 0; i < mesh.facets.size(); i++)
+			REQUIRE(sameNormal(mesh.facets[i].n, eager.mesh.facets[i].n));
+		microstl::fixNormals(fvMesh);
+		REQUIRE(fvMesh.pendingNormals.empty() && sameNormal(fvMesh.facets[2].n, eager.mesh.facets[2].n));
+
+		// Face-vertex handler and the other normal settings
+		microstl::FVMeshReaderHandler fvLazy;
+		fvLazy.lazyNormals = true;
+		res = microstl::Reader::readStlBuffer(data.data(), data.size(), fvLazy);
+		REQUIRE(res == microstl::Result::Success && fvLazy.mesh.pendingNormals.size() == 3 && fvLazy.mesh.pendingNormals[2]);
+		fvLazy.forceNormals = true;
+		res = microstl::Reader::readStlBuffer(data.data(), data.size(), fvLazy);
+		REQUIRE(res == microstl::Result::Success && fvLazy.mesh.pendingNormals == std::vector<bool>({ true, true, true }));
+		lazy.disableNormals = true;
+		res = microstl::Reader::readStlBuffer(data.data(), data.size(), lazy);
+		REQUIRE(res == microstl::Result::Success && lazy.mesh.pendingNormals.empty() && lazy.mesh.facets[2].n.z == 5.0f);
+
+		// Files with valid normals do not allocate any flags
+		microstl::MeshReaderHandler sphere;
+		sphere.lazyNormals = true;
+		res = microstl::Reader::readStlFile(findTestFile("sphere_binary.stl"), sphere);
+		REQUIRE(res == microstl::Result::Success && sphere.mesh.pendingNormals.empty());
+	}
+
+	{
+		TEST_SCOPE("Write binary STL files through memory mappings");
+		microstl::MeshReaderHandler handler;
+		auto res = microstl::Reader::readStlFile(findTestFile("stencil_binary.stl"), handler);
+		REQUIRE(res == microstl::Result::Success);
+		auto readFile = [](const std::filesystem::path& path)
+		{
+			std::ifstream ifs(path, std::ios::binary);
+			return std::string((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+		};
+
+		struct AttributeProvider : microstl::MeshProvider
+		{
+			AttributeProvider(const microstl::Mesh& m) : MeshProvider(m) {}
+			bool writeAttributes() override { return true; }
+			void getFacetAttributes(size_t index, uint8_t attributes[2]) override { attributes[0] = uint8_t(index); attributes[1] = 3; }
+		};
+		AttributeProvider provider(handler.mesh);
+		std::string expected;
+		REQUIRE(microstl::Writer::writeStlBuffer(expected, provider) == microstl::Result::Success);
+		REQUIRE(microstl::Writer::writeStlFile("mapped.stl", provider) == microstl::Result::Success);
+		REQUIRE(readFile("mapped.stl") == expected);
+
+		microstl::MeshProvider plainProvider(handler.mesh);
+		REQUIRE(microstl::Writer::writeStlBuffer(expected, plainProvider) == microstl::Result::Success);
+		REQUIRE(microstl::Writer::writeMeshFile("mapped.stl", handler.mesh) == microstl::Result::Success);
+		REQUIRE(readFile("mapped.stl") == expected);
+
+		// Existing larger files are truncated to the new size
+		microstl::Mesh small;
+		small.facets.assign(handler.mesh.facets.begin(), handler.mesh.facets.begin() + 3);
+		microstl::MeshProvider smallProvider(small);
+		REQUIRE(microstl::Writer::writeStlFile("mapped.stl", smallProvider) == microstl::Result::Success);
+		REQUIRE(std::filesystem::file_size("mapped.stl") == 84 + 3 * 50);
+		microstl::MeshReaderHandler checkHandler;
+		res = microstl::Reader::readStlFile("mapped.stl", checkHandler);
+		REQUIRE(res == microstl::Result::Success && checkHandler.mesh.facets.size() == 3);
+		std::filesystem::remove("mapped.stl");
+
+		// Character devices cannot be preallocated, the stream fallback reports the failed flush
+		if (std::filesystem::exists("/dev/full"))
+		{
+			REQUIRE(microstl::Writer::writeStlFile("/dev/full", plainProvider) == microstl::Result::FileError);
+			REQUIRE(microstl::Writer::writeMeshFile("/dev/full", handler.mesh) == microstl::Result::FileError);
+		}
+
+#ifndef _WIN32
+		// A failing preallocation reports an error instead of crashing later on when writing into the mapping.
+		// The file size limit makes the preallocation fail just like a full disk would do.
+		{
+			std::signal(SIGXFSZ, SIG_IGN);
+			rlimit previous;
+			REQUIRE(getrlimit(RLIMIT_FSIZE, &previous) == 0);
+			rlimit limited = previous;
+			limited.rlim_cur = 4096;
+			REQUIRE(setrlimit(RLIMIT_FSIZE, &limited) == 0);
+			auto providerResult = microstl::Writer::writeStlFile("limited.stl", plainProvider);
+			auto meshResult = microstl::Writer::writeMeshFile("limited.stl", handler.mesh);
+			REQUIRE(setrlimit(RLIMIT_FSIZE, &previous) == 0);
+			std::signal(SIGXFSZ, SIG_DFL);
+			REQUIRE(providerResult == microstl::Result::FileError && meshResult == microstl::Result::FileError);
+			std::filesystem::remove("limited.stl");
+		}
+#endif
+
+		// Exceptions while encoding into the mapping do not leak the mapping or the file
+		struct ThrowingProvider : microstl::MeshProvider
+		{
+			ThrowingProvider(const microstl::Mesh& m) : MeshProvider(m) {}
+			void getFacet(size_t index, float v1[3], float v2[3], float v3[3], float n[3]) override
+			{
+				if (index == 100)
+					throw std::runtime_error("Provider failure");
+				MeshProvider::getFacet(index, v1, v2, v3, n);
+			}
+		};
+		auto countOpenFiles = []()
+		{
+			std::error_code error;
+			auto it = std::filesystem::directory_iterator("/proc/self/fd", error);
+			return error ? size_t(0) : static_cast<size_t>(std::distance(it, std::filesystem::directory_iterator()));
+		};
+		ThrowingProvider throwingProvider(handler.mesh);
+		size_t openFiles = countOpenFiles();
+		bool exception = false;
+		try { microstl::Writer::writeStlFile("mapped.stl", throwingProvider); }
+		catch (const std::runtime_error&) { exception = true; }
+		REQUIRE(exception && countOpenFiles() == openFiles);
+		std::filesystem::remove("mapped.stl");
+	}
+
+	{
+		TEST_SCOPE("Report the progress and cancel reading and writing");
+		microstl::MeshReaderHandler handler;
+		auto res = microstl::Reader::readStlFile(findTestFile("stencil_binary.stl"), handler);
+		REQUIRE(res == microstl::Result::Success);
+		microstl::Mesh mesh;
+		for (int i = 0; i < 5; i++)
+			mesh.facets.insert(mesh.facets.end(), handler.mesh.facets.begin(), handler.mesh.facets.end());
+		const size_t facetCount = mesh.facets.size();
+		REQUIRE(facetCount > 2 * microstl::Reader::PROGRESS_INTERVAL);
+
+		struct ProgressHandler : microstl::MeshReaderHandler
+		{
+			size_t cancelAfter = std::numeric_limits<size_t>::max();
+			std::vector<std::pair<uint64_t, uint64_t>> reports;
+			void onBegin(bool asciiMode) override { reports.clear(); MeshReaderHandler::onBegin(asciiMode); }
+			bool onProgress(uint64_t bytes, uint64_t facets) override
+			{
+				reports.emplace_back(bytes, facets);
+				return reports.size() < cancelAfter;
+			}
+		};
+		struct ProgressProvider : microstl::MeshProvider
+		{
+			size_t cancelAfter = std::numeric_limits<size_t>::max();
+			std::vector<std::pair<uint64_t, uint64_t>> reports;
+			ProgressProvider(const microstl::Mesh& m) : MeshProvider(m) {}
+			bool onProgress(uint64_t bytes, uint64_t facets) override
+			{
+				reports.emplace_back(bytes, facets);
+				return reports.size() < cancelAfter;
+			}
+		};
+
+		// Binary writing reports each block
+		ProgressProvider provider(mesh);
+		std::string binary;
+		REQUIRE(microstl::Writer::writeStlBuffer(binary, provider) == microstl::Result::Success);
+		const size_t blocks = (facetCount + microstl::Writer::PROGRESS_INTERVAL - 1) / microstl::Writer::PROGRESS_INTERVAL;
+		REQUIRE(provider.reports.size() == blocks);
+		REQUIRE(provider.reports.back().first == binary.size() && provider.reports.back().second == facetCount);
+		provider.reports.clear();
+		provider.cancelAfter = 1;
+		std::string buffer;
+		REQUIRE(microstl::Writer::writeStlBuffer(buffer, provider) == microstl::Result::Cancelled);
+		REQUIRE(provider.reports.size() == 1 && buffer.size() == 84 + 50 * microstl::Writer::PROGRESS_INTERVAL);
+		for (bool parallel : { false, true })
+		{
+			provider.reports.clear();
+			res = parallel ? microstl::Writer::writeStlFileParallel("progress.stl", provider, 2) : microstl::Writer::writeStlFile("progress.stl", provider);
+			REQUIRE(res == microstl::Result::Cancelled && provider.reports.size() == 1);
+		}
+		provider.cancelAfter = std::numeric_limits<size_t>::max();
+		provider.reports.clear();
+		REQUIRE(microstl::Writer::writeStlFileParallel("progress.stl", provider, 2) == microstl::Result::Success);
+		REQUIRE(provider.reports.size() == 1 + (facetCount - 1) / 16384 && provider.reports.back().second == facetCount);
+		std::filesystem::remove("progress.stl");
+
+		// ASCII writing
+		provider.ascii = true;
+		provider.reports.clear();
+		std::string ascii;
+		REQUIRE(microstl::Writer::writeStlBuffer(ascii, provider) == microstl::Result::Success);
+		REQUIRE(provider.reports.size() == (facetCount - 1) / microstl::Writer::PROGRESS_INTERVAL);
+		REQUIRE(provider.reports[0].second == microstl::Writer::PROGRESS_INTERVAL && provider.reports[0].first > 0);
+		provider.reports.clear();
+		provider.cancelAfter = 2;
+		REQUIRE(microstl::Writer::writeStlBuffer(buffer, provider) == microstl::Result::Cancelled && buffer.size() < ascii.size());
+
+		// Templated writers report through the optional callback of the options
+		std::vector<std::pair<uint64_t, uint64_t>> reports;
+		size_t cancelAfter = std::numeric_limits<size_t>::max();
+		microstl::WriteOptions options;
+		options.onProgress = [&](uint64_t bytes, uint64_t facets)
+		{
+			reports.emplace_back(bytes, facets);
+			return reports.size() < cancelAfter;
+		};
+		REQUIRE(microstl::Writer::writeMeshBuffer(buffer, mesh, options) == microstl::Result::Success && buffer == binary);
+		REQUIRE(reports.size() == blocks && reports.back() == std::make_pair(uint64_t(binary.size()), uint64_t(facetCount)));
+		reports.clear();
+		cancelAfter = 1;
+		REQUIRE(microstl::Writer::writeMeshBuffer(buffer, mesh, options) == microstl::Result::Cancelled);
+		REQUIRE(reports.size() == 1 && buffer.size() == 84 + 50 * microstl::Writer::PROGRESS_INTERVAL);
+		reports.clear();
+		REQUIRE(microstl::Writer::writeMeshFile("progress.stl", mesh, options) == microstl::Result::Cancelled && reports.size() == 1);
+		std::filesystem::remove("progress.stl");
+		reports.clear();
+		options.ascii = true;
+		REQUIRE(microstl::Writer::writeMeshBuffer(buffer, mesh, options) == microstl::Result::Cancelled && reports.size() == 1);
+
+		// Binary reading
+		ProgressHandler progressHandler;
+		res = microstl::Reader::readStlBuffer(binary.data(), binary.size(), progressHandler);
+		REQUIRE(res == microstl::Result::Success && progressHandler.mesh.facets.size() == facetCount);
+		REQUIRE(progressHandler.reports.size() == (facetCount - 1) / microstl::Reader::PROGRESS_INTERVAL);
+		REQUIRE(progressHandler.reports[1] == std::make_pair(uint64_t(84 + 50 * 2 * microstl::Reader::PROGRESS_INTERVAL), uint64_t(2 * microstl::Reader::PROGRESS_INTERVAL)));
+		progressHandler.cancelAfter = 1;
+		res = microstl::Reader::readStlBuffer(binary.data(), binary.size(), progressHandler);
+		REQUIRE(res == microstl::Result::Cancelled && progressHandler.result == microstl::Result::Cancelled);
+		REQUIRE(progressHandler.mesh.facets.size() == microstl::Reader::PROGRESS_INTERVAL);
+
+		// ASCII reading reports by lines
+		progressHandler.cancelAfter = std::numeric_limits<size_t>::max();
+		res = microstl::Reader::readStlBuffer(ascii.data(), ascii.size(), progressHandler);
+		REQUIRE(res == microstl::Result::Success && progressHandler.mesh.facets.size() == facetCount);
+		REQUIRE(progressHandler.reports.size() == facetCount * 7 / microstl::Reader::PROGRESS_INTERVAL);
+		for (size_t i = 1; i < progressHandler.reports.size(); i++)
+			REQUIRE(progressHandler.reports[i].first > progressHandler.reports[i - 1].first && progressHandler.reports[i].first < ascii.size());
+		progressHandler.cancelAfter = 3;
+		res = microstl::Reader::readStlBuffer(ascii.data(), ascii.size(), progressHandler);
+		REQUIRE(res == microstl::Result::Cancelled && progressHandler.mesh.facets.size() < facetCount);
+
+		// The streaming parser reports after each chunk
+		progressHandler.cancelAfter = 2;
+		microstl::Reader::StreamingParser parser(progressHandler);
+		res = parser.feed(binary.data(), 10000);
+		REQUIRE(res == microstl::Result::Undefined && progressHandler.reports.size() == 1);
+		REQUIRE(progressHandler.reports[0] == std::make_pair(uint64_t(10000), uint64_t(9916 / 50)));
+		res = parser.feed(binary.data() + 10000, 10000);
+		REQUIRE(res == microstl::Result::Cancelled && progressHandler.result == microstl::Result::Cancelled);
+		REQUIRE(parser.feed(binary.data() + 20000, 10000) == microstl::Result::Cancelled);
+	}
+
 	{
 		TEST_SCOPE("Test string conversion for results");
 		REQUIRE(microstl::getResultString(microstl::Result::Undefined) == "Undefined");
@@ -587,6 +2404,8 @@ int main()
 		REQUIRE(microstl::getResultString(microstl::Result::LineLimitError) == "LineLimitError");
 		REQUIRE(microstl::getResultString(microstl::Result::FacetCountError) == "FacetCountError");
 		REQUIRE(microstl::getResultString(microstl::Result::EndianError) == "EndianError");
+		REQUIRE(microstl::getResultString(microstl::Result::CacheFormatError) == "CacheFormatError");
+		REQUIRE(microstl::getResultString(microstl::Result::Cancelled) == "Cancelled");
 	}
 
 	return 0;